@@ -75,8 +75,60 @@ if (NOT UPGEN)
   find_program(UPGEN NAMES upgen PATHS ${CMAKE_BINARY_DIR}/bin REQUIRED)
 endif()
 
-function(target_model target model)
+# upgen version, part of the key for model exports
+execute_process(
+  COMMAND ${UPGEN} --version
+  OUTPUT_VARIABLE UPGEN_VERSION
+  OUTPUT_STRIP_TRAILING_WHITESPACE
+  ERROR_QUIET
+)
+
+find_package(Python3 COMPONENTS Interpreter)
+
+set(UPHY_MODEL_TOOLS_DIR ${CMAKE_CURRENT_LIST_DIR}/../tools)
+set(UPHY_MODEL_EXPORT_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/UPhyModelExport.cmake)
+
+# Generate a synthetic model for scaling tests. Arguments after ARGS
+# are passed to tools/genmodel.py, see genmodel.py --help.
+function(generate_model output)
   set(flags)
+  set(args)
+  set(listArgs ARGS)
+
+  cmake_parse_arguments(arg "${flags}" "${args}" "${listArgs}" ${ARGN})
+
+  if (arg_UNPARSED_ARGUMENTS)
+    message(FATAL_ERROR "generate_model: ${arg_UNPARSED_ARGUMENTS}: unexpected arguments")
+  endif()
+
+  if (NOT Python3_Interpreter_FOUND)
+    message(FATAL_ERROR "generate_model: python3 is required")
+  endif()
+
+  add_custom_command (
+    OUTPUT ${output}
+    DEPENDS ${UPHY_MODEL_TOOLS_DIR}/genmodel.py
+    COMMAND ${Python3_EXECUTABLE} ${UPHY_MODEL_TOOLS_DIR}/genmodel.py
+      ${arg_ARGS} -o ${output}
+    VERBATIM
+  )
+endfunction()
+
+# Generate model.c, model.h and eeprom.bin for a target. With IMAGE,
+# also generate model_image.h with the packed process image layout,
+# see tools/genimage.py. With LOOKUP, also generate model_lookup.c
+# with const lookup tables for parameters, see
+# tools/genlookup.py.
+#
+# upgen only runs when the model contents or the upgen version change,
+# and outputs are only replaced when they differ, see
+# UPhyModelExport.cmake. Each OUTPUT_DIR is exported by its own
+# custom target, so several models export in parallel and targets
+# sharing an OUTPUT_DIR share one export. model_image.h and
+# model_lookup.c are likewise generated once per OUTPUT_DIR, and only
+# when the model contents change.
+function(target_model target model)
+  set(flags IMAGE LOOKUP)
   set(args OUTPUT_DIR)
   set(listArgs)
 
@@ -90,15 +142,47 @@ function(target_model target model)
     message(FATAL_ERROR "target_model: OUTPUT_DIR is a required argument")
   endif()
 
-  add_custom_command (
-    OUTPUT
-    ${arg_OUTPUT_DIR}/model.c
-    ${arg_OUTPUT_DIR}/model.h
-    ${arg_OUTPUT_DIR}/eeprom.bin
-    DEPENDS ${model}
-    COMMAND ${UPGEN} -d ${arg_OUTPUT_DIR} export ${model}
-    VERBATIM
-  )
+  string(SHA256 dir_hash ${arg_OUTPUT_DIR})
+  string(SUBSTRING ${dir_hash} 0 12 dir_hash)
+  set(export_target upgen-export-${dir_hash})
+
+  if (TARGET ${export_target})
+    get_target_property(export_model ${export_target} UPHY_MODEL)
+    if (NOT export_model STREQUAL model)
+      message(FATAL_ERROR
+        "target_model: ${arg_OUTPUT_DIR} is already used for ${export_model}")
+    endif()
+  else()
+    add_custom_command (
+      OUTPUT ${arg_OUTPUT_DIR}/model.stamp
+      BYPRODUCTS
+      ${arg_OUTPUT_DIR}/model.c
+      ${arg_OUTPUT_DIR}/model.h
+      ${arg_OUTPUT_DIR}/eeprom.bin
+      ${arg_OUTPUT_DIR}/model.key
+      DEPENDS ${model} ${UPGEN} ${UPHY_MODEL_EXPORT_SCRIPT}
+      COMMAND ${CMAKE_COMMAND}
+        -DUPGEN=${UPGEN}
+        -DUPGEN_VERSION=${UPGEN_VERSION}
+        -DMODEL=${model}
+        -DOUTPUT_DIR=${arg_OUTPUT_DIR}
+        -DSTAMP=${arg_OUTPUT_DIR}/model.stamp
+        -DKEY=${arg_OUTPUT_DIR}/model.key
+        -P ${UPHY_MODEL_EXPORT_SCRIPT}
+      COMMENT "Exporting ${model}"
+      VERBATIM
+    )
+
+    add_custom_target(${export_target}
+      DEPENDS ${arg_OUTPUT_DIR}/model.stamp
+    )
+
+    set_target_properties(${export_target}
+      PROPERTIES UPHY_MODEL ${model}
+    )
+  endif()
+
+  add_dependencies(${target} ${export_target})
 
   target_sources(${target}
     PRIVATE
@@ -110,4 +194,67 @@ function(target_model target model)
     ${arg_OUTPUT_DIR}/
   )
 
+  if (arg_IMAGE)
+    if (NOT Python3_Interpreter_FOUND)
+      message(FATAL_ERROR "target_model: python3 is required for IMAGE")
+    endif()
+
+    if (NOT TARGET ${export_target}-image)
+      add_custom_command (
+        OUTPUT ${arg_OUTPUT_DIR}/model_image.h
+        DEPENDS
+          ${arg_OUTPUT_DIR}/model.key
+          ${UPHY_MODEL_TOOLS_DIR}/genimage.py
+        COMMAND ${Python3_EXECUTABLE} ${UPHY_MODEL_TOOLS_DIR}/genimage.py
+          ${model} -o ${arg_OUTPUT_DIR}/model_image.h
+        VERBATIM
+      )
+
+      add_custom_target(${export_target}-image
+        DEPENDS ${arg_OUTPUT_DIR}/model_image.h
+      )
+
+      add_dependencies(${export_target}-image ${export_target})
+    endif()
+
+    add_dependencies(${target} ${export_target}-image)
+
+    target_sources(${target}
+      PRIVATE
+      ${arg_OUTPUT_DIR}/model_image.h
+    )
+  endif()
+
+  if (arg_LOOKUP)
+    if (NOT Python3_Interpreter_FOUND)
+      message(FATAL_ERROR "target_model: python3 is required for LOOKUP")
+    endif()
+
+    if (NOT TARGET ${export_target}-lookup)
+      add_custom_command (
+        OUTPUT ${arg_OUTPUT_DIR}/model_lookup.c
+        DEPENDS
+          ${arg_OUTPUT_DIR}/model.key
+          ${UPHY_MODEL_TOOLS_DIR}/genlookup.py
+          ${UPHY_MODEL_TOOLS_DIR}/genimage.py
+        COMMAND ${Python3_EXECUTABLE} ${UPHY_MODEL_TOOLS_DIR}/genlookup.py
+          ${model} -o ${arg_OUTPUT_DIR}/model_lookup.c
+        VERBATIM
+      )
+
+      add_custom_target(${export_target}-lookup
+        DEPENDS ${arg_OUTPUT_DIR}/model_lookup.c
+      )
+
+      add_dependencies(${export_target}-lookup ${export_target})
+    endif()
+
+    add_dependencies(${target} ${export_target}-lookup)
+
+    target_sources(${target}
+      PRIVATE
+      ${arg_OUTPUT_DIR}/model_lookup.c
+    )
+  endif()
+
 endfunction()
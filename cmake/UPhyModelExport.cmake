@@ -0,0 +1,74 @@
+#********************************************************************
+#        _       _         _
+#  _ __ | |_  _ | |  __ _ | |__   ___
+# | '__|| __|(_)| | / _` || '_ \ / __|
+# | |   | |_  _ | || (_| || |_) |\__ \
+# |_|    \__|(_)|_| \__,_||_.__/ |___/
+#
+# www.rt-labs.com
+# Copyright 2024 rt-labs AB, Sweden.
+# See LICENSE file in the project root for full license information.
+#*******************************************************************/
+
+# Export a model with upgen, keyed on the model contents. Run in
+# script mode by target_model():
+#
+#   cmake -DUPGEN=<upgen> -DUPGEN_VERSION=<version> -DMODEL=<model.json>
+#         -DOUTPUT_DIR=<dir> -DSTAMP=<stamp> -DKEY=<key>
+#         -P UPhyModelExport.cmake
+#
+# The key is a hash of the model file and the upgen version. upgen is
+# only run when the key differs from the one in STAMP or an output is
+# missing. upgen writes to a staging directory and each output is only
+# replaced when its contents differ, so that a model change that does
+# not affect an output leaves its timestamp, and the targets built
+# from it, untouched. STAMP is always touched to mark the export as up
+# to date. KEY holds the key and is only written when it changes, for
+# steps that depend on the model contents rather than its timestamp.
+
+set(outputs model.c model.h eeprom.bin)
+
+file(SHA256 ${MODEL} model_hash)
+string(SHA256 key "${model_hash} ${UPGEN_VERSION}")
+
+file(CONFIGURE OUTPUT ${KEY} CONTENT "${key}")
+
+set(up_to_date FALSE)
+if (EXISTS ${STAMP})
+  file(READ ${STAMP} old_key)
+  if (old_key STREQUAL key)
+    set(up_to_date TRUE)
+    foreach(output ${outputs})
+      if (NOT EXISTS ${OUTPUT_DIR}/${output})
+        set(up_to_date FALSE)
+      endif()
+    endforeach()
+  endif()
+endif()
+
+if (up_to_date)
+  file(TOUCH ${STAMP})
+  return()
+endif()
+
+set(staging ${OUTPUT_DIR}/.upgen)
+file(REMOVE_RECURSE ${staging})
+file(MAKE_DIRECTORY ${staging})
+
+execute_process(
+  COMMAND ${UPGEN} -d ${staging} export ${MODEL}
+  RESULT_VARIABLE result
+)
+
+if (NOT result EQUAL 0)
+  message(FATAL_ERROR "upgen export ${MODEL} failed: ${result}")
+endif()
+
+foreach(output ${outputs})
+  file(COPY_FILE ${staging}/${output} ${OUTPUT_DIR}/${output}
+    ONLY_IF_DIFFERENT
+  )
+endforeach()
+
+file(REMOVE_RECURSE ${staging})
+file(WRITE ${STAMP} "${key}")
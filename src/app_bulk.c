@@ -0,0 +1,165 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#include "app_bulk.h"
+
+#include <string.h>
+
+#define ONES 0x0101010101010101ull
+
+/* Bit array word operations assume that the first byte in memory is
+   the least significant byte of a word */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define WORD_BITS 1
+#else
+#define WORD_BITS 0
+#endif
+
+void app_bulk_set_status (
+   const app_image_section_t * section,
+   uint8_t * buf,
+   uint16_t first,
+   uint16_t n,
+   uint8_t keep,
+   uint8_t set)
+{
+   uint8_t * status = buf + section->status_offset + first;
+   uint64_t keep_word = keep * ONES;
+   uint64_t set_word = set * ONES;
+   uint16_t i = 0;
+
+   for (; i + 8 <= n; i += 8)
+   {
+      uint64_t x;
+
+      memcpy (&x, status + i, sizeof (x));
+      x = (x & keep_word) | set_word;
+      memcpy (status + i, &x, sizeof (x));
+   }
+
+   for (; i < n; i++)
+   {
+      status[i] = (status[i] & keep) | set;
+   }
+}
+
+bool app_bulk_status_all (
+   const app_image_section_t * section,
+   const uint8_t * buf,
+   uint16_t first,
+   uint16_t n,
+   uint8_t mask)
+{
+   const uint8_t * status = buf + section->status_offset + first;
+   uint64_t all_word = ~0ull;
+   uint8_t all = 0xFF;
+   uint16_t i = 0;
+
+   /* No early exit, the whole range is usually checked anyway */
+   for (; i + 8 <= n; i += 8)
+   {
+      uint64_t x;
+
+      memcpy (&x, status + i, sizeof (x));
+      all_word &= x;
+   }
+
+   for (; i < n; i++)
+   {
+      all &= status[i];
+   }
+
+   for (i = 0; i < 8; i++)
+   {
+      all &= (uint8_t)(all_word >> (8 * i));
+   }
+
+   return (all & mask) == mask;
+}
+
+void app_bulk_set_var_status (
+   const app_image_t * image,
+   const app_image_section_t * section,
+   uint16_t first,
+   uint16_t n,
+   uint8_t keep,
+   uint8_t set)
+{
+   const app_image_signal_t * signals = section->signals + first;
+   uint16_t i;
+
+   for (i = 0; i < n; i++)
+   {
+      up_signal_status_t * status = image->vars[signals[i].ix].status;
+      *status = (*status & keep) | set;
+   }
+}
+
+#if WORD_BITS
+#define LOW7   0x7F7F7F7F7F7F7F7Full
+#define HIGH   0x8080808080808080ull
+#define BITS   0x8040201008040201ull
+#define GATHER 0x0102040810204080ull
+
+/**
+ * Map each non-zero byte of a word to 0x80 and each zero byte to 0.
+ */
+static uint64_t nonzero_bytes (uint64_t x)
+{
+   return (((x & LOW7) + LOW7) | x) & HIGH;
+}
+#endif
+
+void app_bulk_pack_bits (uint8_t * bits, const uint8_t * values, size_t n)
+{
+   size_t i = 0;
+
+#if WORD_BITS
+   for (; i + 8 <= n; i += 8)
+   {
+      uint64_t x;
+
+      memcpy (&x, values + i, sizeof (x));
+      x = nonzero_bytes (x) >> 7;
+      bits[i / 8] = (uint8_t)((x * GATHER) >> 56);
+   }
+#endif
+
+   for (; i < n; i++)
+   {
+      if (i % 8 == 0)
+      {
+         bits[i / 8] = 0;
+      }
+      bits[i / 8] |= (values[i] != 0) << (i % 8);
+   }
+}
+
+void app_bulk_unpack_bits (uint8_t * values, const uint8_t * bits, size_t n)
+{
+   size_t i = 0;
+
+#if WORD_BITS
+   for (; i + 8 <= n; i += 8)
+   {
+      uint64_t x = (bits[i / 8] * ONES) & BITS;
+
+      x = nonzero_bytes (x) >> 7;
+      memcpy (values + i, &x, sizeof (x));
+   }
+#endif
+
+   for (; i < n; i++)
+   {
+      values[i] = (bits[i / 8] >> (i % 8)) & 1;
+   }
+}
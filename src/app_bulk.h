@@ -0,0 +1,114 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/**
+ * Bulk status and value operations.
+ *
+ * Operate on a range of signals in one call instead of one signal at
+ * a time. Signals of a section are stored in slot order, so the
+ * signals of a slot are a contiguous range.
+ *
+ * In a packed process image section the status bytes form one array,
+ * which the status functions process eight signals at a time as
+ * 64-bit words. The bit array functions also convert eight values
+ * per step. This needs no SIMD instructions, so it works the same on
+ * all targets.
+ */
+
+#ifndef APP_BULK_H
+#define APP_BULK_H
+
+#include "app_image.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Update status of a range of signals in a packed section. Each
+ * status becomes (status & keep) | set, e.g. keep 0xFF and set
+ * UP_STATUS_OK to mark signals as OK, or keep ~UP_STATUS_OK and set 0
+ * to mark them as not OK.
+ *
+ * @param section       section
+ * @param buf           packed section, section->size bytes
+ * @param first         first signal
+ * @param n             number of signals
+ * @param keep          status bits to keep
+ * @param set           status bits to set
+ */
+void app_bulk_set_status (
+   const app_image_section_t * section,
+   uint8_t * buf,
+   uint16_t first,
+   uint16_t n,
+   uint8_t keep,
+   uint8_t set);
+
+/**
+ * Check that all signals in a range of a packed section have status
+ * bits set.
+ *
+ * @param section       section
+ * @param buf           packed section, section->size bytes
+ * @param first         first signal
+ * @param n             number of signals
+ * @param mask          status bits to check
+ * @return true if all status bits in mask are set for all signals
+ */
+bool app_bulk_status_all (
+   const app_image_section_t * section,
+   const uint8_t * buf,
+   uint16_t first,
+   uint16_t n,
+   uint8_t mask);
+
+/**
+ * Update status of a range of signals in up_vars. Each status becomes
+ * (status & keep) | set, see app_bulk_set_status().
+ *
+ * @param image         process image
+ * @param section       section
+ * @param first         first signal
+ * @param n             number of signals
+ * @param keep          status bits to keep
+ * @param set           status bits to set
+ */
+void app_bulk_set_var_status (
+   const app_image_t * image,
+   const app_image_section_t * section,
+   uint16_t first,
+   uint16_t n,
+   uint8_t keep,
+   uint8_t set);
+
+/**
+ * Pack byte values into a bit array, least significant bit first.
+ * Non-zero bytes are packed as 1.
+ *
+ * @param bits          destination, (n + 7) / 8 bytes
+ * @param values        source, n bytes
+ * @param n             number of values
+ */
+void app_bulk_pack_bits (uint8_t * bits, const uint8_t * values, size_t n);
+
+/**
+ * Unpack a bit array, least significant bit first, into byte values
+ * of 0 or 1.
+ *
+ * @param values        destination, n bytes
+ * @param bits          source, (n + 7) / 8 bytes
+ * @param n             number of values
+ */
+void app_bulk_unpack_bits (uint8_t * values, const uint8_t * bits, size_t n);
+
+#endif /* APP_BULK_H */
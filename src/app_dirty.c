@@ -0,0 +1,79 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#include "app_dirty.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int app_dirty_init (
+   app_dirty_t * dirty,
+   const app_image_t * image,
+   const app_image_section_t * section)
+{
+   memset (dirty, 0, sizeof (*dirty));
+   dirty->image = image;
+   dirty->section = section;
+
+   if (section->n_signals == 0)
+   {
+      return 0;
+   }
+
+   dirty->shadow = calloc (1, section->size);
+   if (dirty->shadow == NULL)
+   {
+      return -1;
+   }
+
+   app_dirty_invalidate (dirty);
+   return 0;
+}
+
+uint16_t app_dirty_scan (app_dirty_t * dirty)
+{
+   const app_image_section_t * section = dirty->section;
+   uint8_t * status = dirty->shadow + section->status_offset;
+   uint16_t n_dirty = 0;
+   uint16_t i;
+   bool changed;
+
+   for (i = 0; i < section->n_signals; i++)
+   {
+      const app_image_signal_t * s = &section->signals[i];
+      const up_signal_info_t * var = &dirty->image->vars[s->ix];
+      uint8_t * shadow = dirty->shadow + s->offset;
+
+      changed = status[i] != *var->status ||
+                memcmp (shadow, var->value, s->size) != 0;
+      if (changed)
+      {
+         memcpy (shadow, var->value, s->size);
+         status[i] = *var->status;
+         dirty->n_changes++;
+         dirty->n_bytes += s->size;
+      }
+
+      if (changed || dirty->invalid)
+      {
+         n_dirty++;
+      }
+   }
+
+   dirty->invalid = false;
+   return n_dirty;
+}
+
+void app_dirty_invalidate (app_dirty_t * dirty)
+{
+   dirty->invalid = true;
+}
@@ -0,0 +1,68 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef APP_DIRTY_H
+#define APP_DIRTY_H
+
+#include "app_image.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Change tracking for one process image section. Keeps a shadow copy
+ * of the last seen value and status of each signal.
+ */
+typedef struct app_dirty
+{
+   const app_image_t * image;
+   const app_image_section_t * section;
+   uint8_t * shadow;   /**< Packed copy of last seen section */
+   uint32_t n_changes; /**< Total number of signal changes */
+   uint32_t n_bytes;   /**< Total number of changed value bytes */
+   bool invalid;       /**< Treat all signals as changed */
+} app_dirty_t;
+
+/**
+ * Initialise change tracking for a section. All signals are dirty
+ * after initialisation.
+ *
+ * @param dirty         change tracker
+ * @param image         process image
+ * @param section       section of image to track
+ * @return 0 on success, -1 on allocation failure
+ */
+int app_dirty_init (
+   app_dirty_t * dirty,
+   const app_image_t * image,
+   const app_image_section_t * section);
+
+/**
+ * Compare up_vars with the shadow copy and update the shadow copy.
+ * Only signals that actually changed are counted in n_changes and
+ * n_bytes.
+ *
+ * @param dirty         change tracker
+ * @return number of signals whose value or status changed, or all
+ *         signals if the tracker was invalidated
+ */
+uint16_t app_dirty_scan (app_dirty_t * dirty);
+
+/**
+ * Mark all signals as changed, e.g. to force a periodic full update.
+ * Takes effect on the next scan.
+ *
+ * @param dirty         change tracker
+ */
+void app_dirty_invalidate (app_dirty_t * dirty);
+
+#endif /* APP_DIRTY_H */
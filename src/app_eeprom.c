@@ -0,0 +1,132 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#include "app_eeprom.h"
+
+#include "options.h"
+#include "osal.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#if defined(UP_DEVICE_ETHERCAT_SUPPORTED)
+
+/* Start and end tags for the generated EtherCAT SII eeprom.
+ * Defined in eeprom.S.
+ */
+extern const uint8_t _eeprom_bin_start;
+extern const uint8_t _eeprom_bin_end;
+
+static struct
+{
+   size_t size;  /**< Image size in bytes */
+   uint32_t crc; /**< CRC-32 of image */
+} eeprom;
+
+static uint32_t crc32 (const uint8_t * data, size_t size)
+{
+   uint32_t crc = 0xFFFFFFFF;
+   int bit;
+
+   while (size-- > 0)
+   {
+      crc ^= *data++;
+      for (bit = 0; bit < 8; bit++)
+      {
+         crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+      }
+   }
+
+   return ~crc;
+}
+
+#if defined(APP_EEPROM_MARKER)
+static bool marker_matches (uint32_t crc, size_t size)
+{
+   unsigned long marker_crc;
+   unsigned long marker_size;
+   FILE * f;
+   bool match = false;
+
+   f = fopen (APP_EEPROM_MARKER, "r");
+   if (f != NULL)
+   {
+      match = fscanf (f, "%lx %lu", &marker_crc, &marker_size) == 2 &&
+              marker_crc == crc && marker_size == size;
+      fclose (f);
+   }
+
+   return match;
+}
+
+static void marker_write (uint32_t crc, size_t size)
+{
+   FILE * f;
+
+   f = fopen (APP_EEPROM_MARKER, "w");
+   if (f == NULL)
+   {
+      printf ("Failed to write " APP_EEPROM_MARKER "\n");
+      return;
+   }
+
+   fprintf (f, "%08" PRIx32 " %lu\n", crc, (unsigned long)size);
+   fclose (f);
+}
+#endif
+
+int app_eeprom_write (up_t * up)
+{
+   const uint8_t * data = &_eeprom_bin_start;
+   size_t size = &_eeprom_bin_end - &_eeprom_bin_start;
+   uint32_t t0 = os_get_current_time_us();
+
+   /* The image is constant, compute its CRC once */
+   if (eeprom.size != size)
+   {
+      eeprom.size = size;
+      eeprom.crc = crc32 (data, size);
+   }
+
+#if defined(APP_EEPROM_MARKER)
+   if (marker_matches (eeprom.crc, size))
+   {
+      printf (
+         "EtherCAT eeprom unchanged (crc %08" PRIx32 "), skipped in %" PRIu32
+         " us\n",
+         eeprom.crc,
+         os_get_current_time_us() - t0);
+      return 0;
+   }
+#endif
+
+   if (up_write_ecat_eeprom (up, data, size) != 0)
+   {
+      return -1;
+   }
+
+#if defined(APP_EEPROM_MARKER)
+   marker_write (eeprom.crc, size);
+#endif
+
+   printf (
+      "EtherCAT eeprom written, %lu bytes (crc %08" PRIx32 ") in %" PRIu32
+      " us\n",
+      (unsigned long)size,
+      eeprom.crc,
+      os_get_current_time_us() - t0);
+
+   return 0;
+}
+
+#endif /* UP_DEVICE_ETHERCAT_SUPPORTED */
@@ -0,0 +1,38 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/**
+ * EtherCAT SII eeprom download.
+ *
+ * Writes the eeprom image embedded by eeprom.S to the core. If
+ * APP_EEPROM_MARKER is defined, the CRC-32 of the last successfully
+ * written image is stored in that file and the write is skipped while
+ * the image is unchanged. The time taken is printed on every start,
+ * to show the savings. Only define it if the core keeps its eeprom
+ * across restarts, and remove the marker when the core is replaced.
+ */
+
+#ifndef APP_EEPROM_H
+#define APP_EEPROM_H
+
+#include "up_api.h"
+
+/**
+ * Write the EtherCAT eeprom image to the core, unless it is known to
+ * hold the same image already.
+ *
+ * @param up            u-phy instance
+ * @return 0 on success, -1 on failure
+ */
+int app_eeprom_write (up_t * up);
+
+#endif /* APP_EEPROM_H */
@@ -0,0 +1,292 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#include "app_image.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t align_offset (uint32_t offset, uint16_t size)
+{
+   uint32_t align = 1;
+
+   /* Align to natural size for scalar types, byte align anything
+      else (e.g. bit arrays) */
+   if (size == 2 || size == 4 || size == 8)
+   {
+      align = size;
+   }
+
+   return (offset + align - 1) & ~(align - 1);
+}
+
+static void section_add (
+   app_image_section_t * section,
+   const char * slot,
+   const up_signal_t * signal)
+{
+   app_image_signal_t * s = &section->signals[section->n_signals++];
+
+   s->slot = slot;
+   s->name = signal->name;
+   s->ix = signal->ix;
+   s->datatype = signal->datatype;
+   s->size = (signal->bitlength + 7) / 8;
+   s->offset = align_offset (section->status_offset, s->size);
+
+   section->status_offset = s->offset + s->size;
+}
+
+static int section_alloc (app_image_section_t * section, uint16_t n_signals)
+{
+   memset (section, 0, sizeof (*section));
+   if (n_signals == 0)
+   {
+      return 0;
+   }
+
+   section->signals = calloc (n_signals, sizeof (app_image_signal_t));
+   return (section->signals == NULL) ? -1 : 0;
+}
+
+int app_image_init (
+   app_image_t * image,
+   const up_device_t * device,
+   up_signal_info_t * vars)
+{
+   uint16_t n_inputs = 0;
+   uint16_t n_outputs = 0;
+   uint16_t slot_ix;
+   uint16_t ix;
+
+   for (slot_ix = 0; slot_ix < device->n_slots; slot_ix++)
+   {
+      n_inputs += device->slots[slot_ix].n_inputs;
+      n_outputs += device->slots[slot_ix].n_outputs;
+   }
+
+   image->vars = vars;
+   if (
+      section_alloc (&image->inputs, n_inputs) != 0 ||
+      section_alloc (&image->outputs, n_outputs) != 0)
+   {
+      free (image->inputs.signals);
+      return -1;
+   }
+
+   for (slot_ix = 0; slot_ix < device->n_slots; slot_ix++)
+   {
+      const up_slot_t * slot = &device->slots[slot_ix];
+
+      for (ix = 0; ix < slot->n_inputs; ix++)
+      {
+         section_add (&image->inputs, slot->name, &slot->inputs[ix]);
+      }
+
+      for (ix = 0; ix < slot->n_outputs; ix++)
+      {
+         section_add (&image->outputs, slot->name, &slot->outputs[ix]);
+      }
+   }
+
+   image->inputs.size = image->inputs.status_offset + n_inputs;
+   image->outputs.size = image->outputs.status_offset + n_outputs;
+
+   return 0;
+}
+
+void app_image_pack (
+   const app_image_t * image,
+   const app_image_section_t * section,
+   uint8_t * buf)
+{
+   uint8_t * status = buf + section->status_offset;
+   uint16_t i;
+
+   for (i = 0; i < section->n_signals; i++)
+   {
+      const app_image_signal_t * s = &section->signals[i];
+      const up_signal_info_t * var = &image->vars[s->ix];
+
+      memcpy (buf + s->offset, var->value, s->size);
+      status[i] = *var->status;
+   }
+}
+
+void app_image_unpack (
+   const app_image_t * image,
+   const app_image_section_t * section,
+   const uint8_t * buf)
+{
+   const uint8_t * status = buf + section->status_offset;
+   uint16_t i;
+
+   for (i = 0; i < section->n_signals; i++)
+   {
+      const app_image_signal_t * s = &section->signals[i];
+      up_signal_info_t * var = &image->vars[s->ix];
+
+      memcpy (var->value, buf + s->offset, s->size);
+      *var->status = status[i];
+   }
+}
+
+uint16_t app_image_n_vars (const up_device_t * device)
+{
+   uint16_t n_vars = 0;
+   uint16_t slot_ix;
+   uint16_t ix;
+
+   for (slot_ix = 0; slot_ix < device->n_slots; slot_ix++)
+   {
+      const up_slot_t * slot = &device->slots[slot_ix];
+
+      for (ix = 0; ix < slot->n_inputs; ix++)
+      {
+         if (slot->inputs[ix].ix >= n_vars)
+         {
+            n_vars = slot->inputs[ix].ix + 1;
+         }
+      }
+
+      for (ix = 0; ix < slot->n_outputs; ix++)
+      {
+         if (slot->outputs[ix].ix >= n_vars)
+         {
+            n_vars = slot->outputs[ix].ix + 1;
+         }
+      }
+
+      for (ix = 0; ix < slot->n_params; ix++)
+      {
+         if (slot->params[ix].ix >= n_vars)
+         {
+            n_vars = slot->params[ix].ix + 1;
+         }
+      }
+   }
+
+   return n_vars;
+}
+
+static void * relocate (void * p, const void * from, void * to, size_t size)
+{
+   uintptr_t addr = (uintptr_t)p;
+   uintptr_t base = (uintptr_t)from;
+
+   if (p == NULL || addr < base || addr >= base + size)
+   {
+      return p;
+   }
+
+   return (uint8_t *)to + (addr - base);
+}
+
+void app_image_relocate (
+   const up_signal_info_t * vars,
+   up_signal_info_t * copy,
+   uint16_t n_vars,
+   const void * from,
+   void * to,
+   size_t size)
+{
+   uint16_t i;
+
+   for (i = 0; i < n_vars; i++)
+   {
+      copy[i].value = relocate (vars[i].value, from, to, size);
+      copy[i].status = relocate (vars[i].status, from, to, size);
+   }
+}
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME  16777619u
+
+static uint32_t hash_bytes (uint32_t hash, const void * data, size_t size)
+{
+   const uint8_t * p = data;
+
+   while (size-- > 0)
+   {
+      hash = (hash ^ *p++) * FNV_PRIME;
+   }
+
+   return hash;
+}
+
+static uint32_t hash_u32 (uint32_t hash, uint32_t value)
+{
+   uint8_t bytes[4];
+
+   /* Byte order independent */
+   bytes[0] = value & 0xFF;
+   bytes[1] = (value >> 8) & 0xFF;
+   bytes[2] = (value >> 16) & 0xFF;
+   bytes[3] = (value >> 24) & 0xFF;
+   return hash_bytes (hash, bytes, sizeof (bytes));
+}
+
+static uint32_t hash_str (uint32_t hash, const char * str)
+{
+   /* Include terminator to separate adjacent strings */
+   return hash_bytes (hash, str, strlen (str) + 1);
+}
+
+static uint32_t hash_signal (uint32_t hash, const up_signal_t * signal)
+{
+   hash = hash_str (hash, signal->name);
+   hash = hash_u32 (hash, signal->ix);
+   hash = hash_u32 (hash, signal->datatype);
+   return hash_u32 (hash, signal->bitlength);
+}
+
+uint32_t app_image_hash (const up_device_t * device)
+{
+   uint32_t hash = FNV_OFFSET;
+   uint16_t slot_ix;
+   uint16_t ix;
+
+   hash = hash_str (hash, device->name);
+   hash = hash_u32 (hash, device->bustype);
+   hash = hash_u32 (hash, device->n_slots);
+
+   for (slot_ix = 0; slot_ix < device->n_slots; slot_ix++)
+   {
+      const up_slot_t * slot = &device->slots[slot_ix];
+
+      hash = hash_str (hash, slot->name);
+      hash = hash_u32 (hash, slot->n_inputs);
+      for (ix = 0; ix < slot->n_inputs; ix++)
+      {
+         hash = hash_signal (hash, &slot->inputs[ix]);
+      }
+
+      hash = hash_u32 (hash, slot->n_outputs);
+      for (ix = 0; ix < slot->n_outputs; ix++)
+      {
+         hash = hash_signal (hash, &slot->outputs[ix]);
+      }
+
+      hash = hash_u32 (hash, slot->n_params);
+      for (ix = 0; ix < slot->n_params; ix++)
+      {
+         const up_param_t * param = &slot->params[ix];
+
+         hash = hash_str (hash, param->name);
+         hash = hash_u32 (hash, param->ix);
+         hash = hash_u32 (hash, param->datatype);
+         hash = hash_u32 (hash, param->bitlength);
+      }
+   }
+
+   return hash;
+}
@@ -0,0 +1,133 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#ifndef APP_IMAGE_H
+#define APP_IMAGE_H
+
+#include "up_api.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Signal location in a packed process image section.
+ */
+typedef struct app_image_signal
+{
+   const char * slot; /**< Slot name */
+   const char * name; /**< Signal name */
+   uint16_t ix;       /**< Index into up_vars */
+   uint16_t size;     /**< Value size in bytes */
+   uint32_t offset;   /**< Value offset within section */
+   up_dtype_t datatype;
+} app_image_signal_t;
+
+/**
+ * Packed process image section. All values are stored naturally
+ * aligned from offset 0, followed by one status byte per signal
+ * starting at status_offset.
+ */
+typedef struct app_image_section
+{
+   app_image_signal_t * signals;
+   uint16_t n_signals;
+   uint32_t status_offset; /**< Offset of status array */
+   uint32_t size;          /**< Section size in bytes */
+} app_image_section_t;
+
+/**
+ * Packed process image covering all inputs and outputs in up_vars.
+ */
+typedef struct app_image
+{
+   up_signal_info_t * vars;
+   app_image_section_t inputs;
+   app_image_section_t outputs;
+} app_image_t;
+
+/**
+ * Build the process image layout for a device model.
+ *
+ * @param image         process image to initialise
+ * @param device        device model
+ * @param vars          variables of device model
+ * @return 0 on success, -1 on allocation failure
+ */
+int app_image_init (
+   app_image_t * image,
+   const up_device_t * device,
+   up_signal_info_t * vars);
+
+/**
+ * Copy values and status from up_vars into a packed section.
+ *
+ * @param image         process image
+ * @param section       section to pack
+ * @param buf           destination, at least section->size bytes
+ */
+void app_image_pack (
+   const app_image_t * image,
+   const app_image_section_t * section,
+   uint8_t * buf);
+
+/**
+ * Copy values and status from a packed section into up_vars.
+ *
+ * @param image         process image
+ * @param section       section to unpack
+ * @param buf           source, at least section->size bytes
+ */
+void app_image_unpack (
+   const app_image_t * image,
+   const app_image_section_t * section,
+   const uint8_t * buf);
+
+/**
+ * Get hash of a device configuration. Covers bus type, slots,
+ * signals and parameters (names, indices, datatypes and sizes), so
+ * that two configurations with the same hash have the same process
+ * image layout.
+ *
+ * @param device        device model
+ * @return 32-bit FNV-1a hash
+ */
+uint32_t app_image_hash (const up_device_t * device);
+
+/**
+ * Get number of entries in up_vars used by a device model.
+ *
+ * @param device        device model
+ * @return one more than the highest signal or parameter index
+ */
+uint16_t app_image_n_vars (const up_device_t * device);
+
+/**
+ * Make a copy of up_vars referring to a copy of the process data.
+ * Pointers into [from, from + size) are moved to the same offset in
+ * to, other pointers are copied unchanged.
+ *
+ * @param vars          variables of device model
+ * @param copy          destination, n_vars entries
+ * @param n_vars        number of variables
+ * @param from          process data referred to by vars
+ * @param to            copy of process data
+ * @param size          size of process data
+ */
+void app_image_relocate (
+   const up_signal_info_t * vars,
+   up_signal_info_t * copy,
+   uint16_t n_vars,
+   const void * from,
+   void * to,
+   size_t size);
+
+#endif /* APP_IMAGE_H */
@@ -0,0 +1,583 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#include "app_journal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME  16777619u
+
+#define JOURNAL_EVENT_FLUSH BIT (0)
+#define JOURNAL_PATH_SIZE   256
+
+static uint32_t checksum (const void * data, size_t size)
+{
+   const uint8_t * p = data;
+   uint32_t hash = FNV_OFFSET;
+
+   while (size-- > 0)
+   {
+      hash = (hash ^ *p++) * FNV_PRIME;
+   }
+
+   return hash;
+}
+
+static void file_path (
+   const app_journal_t * journal,
+   uint8_t file,
+   char * path,
+   size_t size)
+{
+   snprintf (path, size, "%s.%c", journal->path, 'a' + file);
+}
+
+/**
+ * Flush buffered data of a file and wait until it has reached
+ * storage.
+ *
+ * @return 0 on success, -1 on error
+ */
+static int sync_file (FILE * f)
+{
+   if (fflush (f) != 0 || fsync (fileno (f)) != 0)
+   {
+      return -1;
+   }
+
+   return 0;
+}
+
+static size_t record_size (const app_journal_entry_t * entry)
+{
+   return sizeof (app_journal_record_t) + entry->size + sizeof (uint32_t);
+}
+
+/**
+ * Serialise the staged value of an entry as a record.
+ *
+ * @return size of record
+ */
+static size_t put_record (
+   const app_journal_t * journal,
+   const app_journal_entry_t * entry,
+   uint8_t * buf)
+{
+   app_journal_record_t record;
+   size_t size = sizeof (record) + entry->size;
+   uint32_t check;
+
+   record.slot_ix = entry->slot_ix;
+   record.param_ix = entry->param_ix;
+   record.length = entry->size;
+   record.reserved = 0;
+
+   memcpy (buf, &record, sizeof (record));
+   memcpy (buf + sizeof (record), journal->shadow + entry->offset, entry->size);
+   check = checksum (buf, size);
+   memcpy (buf + size, &check, sizeof (check));
+
+   return size + sizeof (check);
+}
+
+static app_journal_entry_t * find_entry (
+   const app_journal_t * journal,
+   uint16_t slot_ix,
+   uint16_t param_ix)
+{
+   const app_lookup_param_t * p;
+   int16_t ix;
+
+   p = app_lookup_param (journal->lookup, slot_ix, param_ix);
+   if (p == NULL)
+   {
+      return NULL;
+   }
+
+   ix = journal->map[p - journal->lookup->params];
+   return (ix < 0) ? NULL : &journal->entries[ix];
+}
+
+static int read_header (
+   const app_journal_t * journal,
+   uint8_t file,
+   app_journal_header_t * header)
+{
+   char path[JOURNAL_PATH_SIZE];
+   FILE * f;
+   size_t n;
+
+   file_path (journal, file, path, sizeof (path));
+   f = fopen (path, "rb");
+   if (f == NULL)
+   {
+      return -1;
+   }
+
+   n = fread (header, sizeof (*header), 1, f);
+   fclose (f);
+
+   if (
+      n != 1 ||
+      memcmp (header->magic, APP_JOURNAL_MAGIC, sizeof (header->magic)) != 0 ||
+      header->version != APP_JOURNAL_VERSION || header->hash != journal->hash)
+   {
+      return -1;
+   }
+
+   return 0;
+}
+
+/**
+ * Replay records of a journal file into the shadow values.
+ *
+ * @param journal       journal
+ * @param file          file to replay
+ * @param size          size of valid part of file
+ * @return 0 if the whole file is valid, -1 if it ends with a torn or
+ *         corrupt record
+ */
+static int replay (app_journal_t * journal, uint8_t file, size_t * size)
+{
+   char path[JOURNAL_PATH_SIZE];
+   app_journal_record_t record;
+   app_journal_entry_t * entry;
+   uint32_t check;
+   size_t length;
+   size_t n;
+   int result = -1;
+   FILE * f;
+
+   file_path (journal, file, path, sizeof (path));
+   f = fopen (path, "rb");
+   if (f == NULL || fseek (f, sizeof (app_journal_header_t), SEEK_SET) != 0)
+   {
+      if (f != NULL)
+      {
+         fclose (f);
+      }
+      return -1;
+   }
+
+   *size = sizeof (app_journal_header_t);
+
+   for (;;)
+   {
+      n = fread (&record, 1, sizeof (record), f);
+      if (n != sizeof (record))
+      {
+         /* Clean end of file if no partial record remains */
+         result = (n == 0) ? 0 : -1;
+         break;
+      }
+
+      /* Stage record in buf, which holds a record of each entry */
+      length = sizeof (record) + record.length;
+      if (length + sizeof (check) > journal->buf_size)
+      {
+         break;
+      }
+
+      memcpy (journal->buf, &record, sizeof (record));
+      if (
+         fread (journal->buf + sizeof (record), record.length, 1, f) != 1 ||
+         fread (&check, sizeof (check), 1, f) != 1 ||
+         check != checksum (journal->buf, length))
+      {
+         break;
+      }
+
+      entry = find_entry (journal, record.slot_ix, record.param_ix);
+      if (entry != NULL && record.length <= entry->size)
+      {
+         memcpy (
+            journal->shadow + entry->offset,
+            journal->buf + sizeof (record),
+            record.length);
+         journal->n_restored++;
+      }
+
+      *size += length + sizeof (check);
+   }
+
+   fclose (f);
+   return result;
+}
+
+/**
+ * Write a snapshot of all staged values to the inactive file and
+ * make it the active file.
+ */
+static int compact (app_journal_t * journal)
+{
+   char path[JOURNAL_PATH_SIZE];
+   app_journal_header_t header;
+   uint8_t file = journal->active ^ 1;
+   size_t n = 0;
+   uint16_t i;
+   bool error;
+   FILE * f;
+
+   memset (&header, 0, sizeof (header));
+   header.version = APP_JOURNAL_VERSION;
+   header.generation = journal->generation + 1;
+   header.hash = journal->hash;
+
+   os_mutex_lock (journal->mutex);
+   for (i = 0; i < journal->n_entries; i++)
+   {
+      n += put_record (journal, &journal->entries[i], journal->buf + n);
+      journal->entries[i].dirty = false;
+   }
+   os_mutex_unlock (journal->mutex);
+
+   /* Complete the header last, once the snapshot has reached storage,
+      so that an interrupted compaction leaves an invalid file */
+   file_path (journal, file, path, sizeof (path));
+   f = fopen (path, "wb");
+   if (f == NULL)
+   {
+      error = true;
+   }
+   else
+   {
+      error = fwrite (&header, sizeof (header), 1, f) != 1 ||
+              (n > 0 && fwrite (journal->buf, n, 1, f) != 1) ||
+              sync_file (f) != 0 || fseek (f, 0, SEEK_SET) != 0 ||
+              fwrite (APP_JOURNAL_MAGIC, sizeof (header.magic), 1, f) != 1 ||
+              sync_file (f) != 0;
+      error = (fclose (f) != 0) || error;
+   }
+
+   if (error)
+   {
+      /* The active file may be torn or lack a header, so never append
+         to it. Retry compaction on next flush. */
+      os_mutex_lock (journal->mutex);
+      for (i = 0; i < journal->n_entries; i++)
+      {
+         journal->entries[i].dirty = true;
+      }
+      os_mutex_unlock (journal->mutex);
+      journal->size = journal->max_size;
+      journal->n_errors++;
+      return -1;
+   }
+
+   journal->active = file;
+   journal->generation = header.generation;
+   journal->size = sizeof (header) + n;
+   journal->n_compactions++;
+   return 0;
+}
+
+/**
+ * Append staged values changed since the last flush to the active
+ * file, or compact if the file would grow beyond its maximum size.
+ */
+static void flush (app_journal_t * journal)
+{
+   char path[JOURNAL_PATH_SIZE];
+   uint16_t n_records = 0;
+   size_t n = 0;
+   uint16_t i;
+   bool error;
+   FILE * f;
+
+   os_mutex_lock (journal->mutex);
+   for (i = 0; i < journal->n_entries; i++)
+   {
+      if (journal->entries[i].dirty)
+      {
+         n += put_record (journal, &journal->entries[i], journal->buf + n);
+         journal->entries[i].dirty = false;
+         n_records++;
+      }
+   }
+   os_mutex_unlock (journal->mutex);
+
+   if (n == 0)
+   {
+      return;
+   }
+
+   if (journal->size + n > journal->max_size)
+   {
+      /* Snapshot includes the values just taken */
+      compact (journal);
+      return;
+   }
+
+   file_path (journal, journal->active, path, sizeof (path));
+   f = fopen (path, "ab");
+   if (f == NULL)
+   {
+      error = true;
+   }
+   else
+   {
+      error = fwrite (journal->buf, n, 1, f) != 1 || sync_file (f) != 0;
+      error = (fclose (f) != 0) || error;
+   }
+
+   if (error)
+   {
+      /* The file may end with a partial record, so compact on next
+         flush. Compaction writes all values. */
+      os_mutex_lock (journal->mutex);
+      for (i = 0; i < journal->n_entries; i++)
+      {
+         journal->entries[i].dirty = true;
+      }
+      os_mutex_unlock (journal->mutex);
+      journal->size = journal->max_size;
+      journal->n_errors++;
+      return;
+   }
+
+   journal->size += n;
+   journal->n_flushes++;
+   journal->n_records += n_records;
+}
+
+static void flush_thread (void * arg)
+{
+   app_journal_t * journal = arg;
+   uint32_t value;
+
+   for (;;)
+   {
+      os_event_wait (
+         journal->event,
+         JOURNAL_EVENT_FLUSH,
+         &value,
+         journal->interval_ms);
+      os_event_clr (journal->event, JOURNAL_EVENT_FLUSH);
+      flush (journal);
+   }
+}
+
+/**
+ * Restore staged values from the newest valid journal file. Starts a
+ * new file if there is none or if it ends with a torn record.
+ */
+static void restore (app_journal_t * journal)
+{
+   app_journal_header_t header[2];
+   bool valid[2];
+   uint8_t file;
+   size_t size;
+
+   valid[0] = read_header (journal, 0, &header[0]) == 0;
+   valid[1] = read_header (journal, 1, &header[1]) == 0;
+
+   if (!valid[0] && !valid[1])
+   {
+      journal->active = 1;
+      compact (journal);
+      return;
+   }
+
+   if (valid[0] && valid[1])
+   {
+      file = ((int32_t)(header[1].generation - header[0].generation) > 0);
+   }
+   else
+   {
+      file = valid[1];
+   }
+
+   journal->active = file;
+   journal->generation = header[file].generation;
+
+   if (replay (journal, file, &size) == 0 && size <= journal->max_size)
+   {
+      journal->size = size;
+   }
+   else
+   {
+      compact (journal);
+   }
+}
+
+int app_journal_init (
+   app_journal_t * journal,
+   const app_lookup_t * lookup,
+   up_signal_info_t * vars,
+   uint32_t hash,
+   const char * path,
+   size_t max_size)
+{
+   uint16_t n_params = lookup->param_base[lookup->n_slots];
+   size_t shadow_size = 0;
+   uint16_t slot_ix;
+   uint16_t i;
+
+   memset (journal, 0, sizeof (*journal));
+   journal->lookup = lookup;
+   journal->hash = hash;
+   journal->path = path;
+   journal->max_size = max_size;
+
+   for (i = 0; i < n_params; i++)
+   {
+      if (lookup->params[i].flags & APP_LOOKUP_PERSISTENT)
+      {
+         journal->n_entries++;
+         shadow_size += lookup->params[i].size;
+      }
+   }
+
+   journal->entries =
+      calloc (journal->n_entries + 1, sizeof (app_journal_entry_t));
+   journal->map = calloc (n_params + 1, sizeof (int16_t));
+   journal->shadow = calloc (shadow_size + 1, 1);
+   journal->mutex = os_mutex_create();
+   journal->event = os_event_create();
+   if (
+      journal->entries == NULL || journal->map == NULL ||
+      journal->shadow == NULL || journal->mutex == NULL ||
+      journal->event == NULL)
+   {
+      return -1;
+   }
+
+   /* Initial values are those set by up_util_init() */
+   journal->n_entries = 0;
+   shadow_size = 0;
+   for (slot_ix = 0; slot_ix < lookup->n_slots; slot_ix++)
+   {
+      for (i = lookup->param_base[slot_ix];
+           i < lookup->param_base[slot_ix + 1];
+           i++)
+      {
+         const app_lookup_param_t * p = &lookup->params[i];
+         app_journal_entry_t * entry = &journal->entries[journal->n_entries];
+
+         journal->map[i] = -1;
+         if (!(p->flags & APP_LOOKUP_PERSISTENT))
+         {
+            continue;
+         }
+
+         entry->slot_ix = slot_ix;
+         entry->param_ix = i - lookup->param_base[slot_ix];
+         entry->ix = p->ix;
+         entry->size = p->size;
+         entry->offset = shadow_size;
+         memcpy (journal->shadow + shadow_size, vars[p->ix].value, p->size);
+
+         journal->map[i] = journal->n_entries++;
+         shadow_size += p->size;
+         journal->buf_size += record_size (entry);
+      }
+   }
+
+   if (journal->n_entries == 0)
+   {
+      return 0;
+   }
+
+   journal->buf = malloc (journal->buf_size);
+   if (journal->buf == NULL)
+   {
+      return -1;
+   }
+
+   /* A snapshot must always fit */
+   if (journal->max_size < sizeof (app_journal_header_t) + journal->buf_size)
+   {
+      journal->max_size = sizeof (app_journal_header_t) + journal->buf_size;
+   }
+
+   restore (journal);
+
+   for (i = 0; i < journal->n_entries; i++)
+   {
+      const app_journal_entry_t * entry = &journal->entries[i];
+      memcpy (
+         vars[entry->ix].value,
+         journal->shadow + entry->offset,
+         entry->size);
+   }
+
+   return 0;
+}
+
+int app_journal_start (
+   app_journal_t * journal,
+   uint32_t priority,
+   size_t stack_size,
+   uint32_t interval_ms)
+{
+   if (journal->n_entries == 0)
+   {
+      return 0;
+   }
+
+   journal->interval_ms = interval_ms;
+   if (
+      os_thread_create (
+         "journal",
+         priority,
+         stack_size,
+         flush_thread,
+         journal) == NULL)
+   {
+      return -1;
+   }
+
+   return 0;
+}
+
+void app_journal_write (
+   app_journal_t * journal,
+   uint16_t slot_ix,
+   uint16_t param_ix,
+   const void * value,
+   uint16_t length)
+{
+   app_journal_entry_t * entry;
+
+   if (journal->n_entries == 0)
+   {
+      return;
+   }
+
+   entry = find_entry (journal, slot_ix, param_ix);
+   if (entry == NULL || length > entry->size)
+   {
+      return;
+   }
+
+   os_mutex_lock (journal->mutex);
+   memcpy (journal->shadow + entry->offset, value, length);
+   if (entry->dirty)
+   {
+      journal->n_coalesced++;
+   }
+   entry->dirty = true;
+   journal->n_staged++;
+   os_mutex_unlock (journal->mutex);
+}
+
+void app_journal_request_flush (app_journal_t * journal)
+{
+   if (journal->n_entries > 0)
+   {
+      os_event_set (journal->event, JOURNAL_EVENT_FLUSH);
+   }
+}
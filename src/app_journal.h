@@ -0,0 +1,177 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/**
+ * Write-behind journal for persistent parameters.
+ *
+ * Writes to parameters marked persistent in the model are staged in
+ * memory by the cyclic thread, which only copies the value under a
+ * short lock. A flush thread periodically appends the values changed
+ * since the previous flush to a journal file. Repeated writes to a
+ * parameter between flushes are coalesced into one record.
+ *
+ * The journal alternates between two files, <path>.a and <path>.b.
+ * When the active file grows beyond its maximum size, a snapshot of
+ * all persistent values is written to the other file, which then
+ * becomes active. The file header is completed last, after the
+ * snapshot has been synced to storage, so an interrupted compaction
+ * leaves the previous file in use. Appended records are synced before
+ * the flush completes. Alternating also spreads the writes over both
+ * files.
+ *
+ * On restore the valid file with the highest generation is replayed.
+ * Each record carries a checksum, and replay stops at the first torn
+ * or corrupt record. Journals written for another device
+ * configuration are ignored.
+ */
+
+#ifndef APP_JOURNAL_H
+#define APP_JOURNAL_H
+
+#include "app_lookup.h"
+#include "osal.h"
+#include "up_api.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define APP_JOURNAL_MAGIC   "UPPJ"
+#define APP_JOURNAL_VERSION 1
+
+/**
+ * File header.
+ */
+typedef struct app_journal_header
+{
+   char magic[4];       /**< APP_JOURNAL_MAGIC, written last */
+   uint16_t version;    /**< APP_JOURNAL_VERSION */
+   uint16_t reserved;
+   uint32_t generation; /**< Incremented by each compaction */
+   uint32_t hash;       /**< Device configuration hash */
+} app_journal_header_t;
+
+/**
+ * Record header, followed by length bytes of value and a 32-bit
+ * FNV-1a checksum of header and value.
+ */
+typedef struct app_journal_record
+{
+   uint16_t slot_ix;
+   uint16_t param_ix;
+   uint16_t length;
+   uint16_t reserved;
+} app_journal_record_t;
+
+/**
+ * Persistent parameter.
+ */
+typedef struct app_journal_entry
+{
+   uint16_t slot_ix;
+   uint16_t param_ix;
+   uint16_t ix;     /**< Index into up_vars */
+   uint16_t size;   /**< Value size in bytes */
+   uint32_t offset; /**< Value offset in shadow */
+   bool dirty;      /**< Changed since last flush */
+} app_journal_entry_t;
+
+typedef struct app_journal
+{
+   const app_lookup_t * lookup;
+   const char * path;
+   uint32_t hash;
+   size_t max_size;      /**< Compact when active file grows beyond this */
+   uint32_t interval_ms; /**< Flush interval */
+
+   app_journal_entry_t * entries;
+   uint16_t n_entries;
+   int16_t * map;    /**< Entry for each parameter of lookup, or -1 */
+   uint8_t * shadow; /**< Latest staged values */
+   uint8_t * buf;    /**< Records being written */
+   size_t buf_size;
+
+   os_mutex_t * mutex;
+   os_event_t * event;
+   uint32_t generation;
+   uint8_t active; /**< Active file, 0 for .a and 1 for .b */
+   size_t size;    /**< Size of active file */
+
+   uint32_t n_staged;    /**< Persistent parameter writes */
+   uint32_t n_coalesced; /**< Writes replacing an unflushed write */
+   uint32_t n_flushes;   /**< Flushes that appended records */
+   uint32_t n_records;   /**< Records appended */
+   uint32_t n_compactions;
+   uint32_t n_restored;  /**< Records replayed at restore */
+   uint32_t n_errors;    /**< Failed file operations */
+} app_journal_t;
+
+/**
+ * Initialise journal and restore persistent parameter values into
+ * vars. Call after up_util_init() and before the device is started.
+ *
+ * @param journal       journal
+ * @param lookup        lookup tables, see app_lookup_check()
+ * @param vars          variables of device model
+ * @param hash          device configuration hash, see app_image_hash()
+ * @param path          base path of journal files
+ * @param max_size      maximum size of a journal file before compaction
+ * @return 0 on success, -1 on allocation failure
+ */
+int app_journal_init (
+   app_journal_t * journal,
+   const app_lookup_t * lookup,
+   up_signal_info_t * vars,
+   uint32_t hash,
+   const char * path,
+   size_t max_size);
+
+/**
+ * Start flush thread.
+ *
+ * @param journal       journal
+ * @param priority      thread priority
+ * @param stack_size    thread stack size
+ * @param interval_ms   flush interval
+ * @return 0 on success, -1 on failure
+ */
+int app_journal_start (
+   app_journal_t * journal,
+   uint32_t priority,
+   size_t stack_size,
+   uint32_t interval_ms);
+
+/**
+ * Stage a parameter write. Writes to parameters that are not
+ * persistent are ignored. Does not block on file operations.
+ *
+ * @param journal       journal
+ * @param slot_ix       slot index
+ * @param param_ix      parameter index within slot
+ * @param value         value
+ * @param length        value length in bytes
+ */
+void app_journal_write (
+   app_journal_t * journal,
+   uint16_t slot_ix,
+   uint16_t param_ix,
+   const void * value,
+   uint16_t length);
+
+/**
+ * Request an immediate flush by the flush thread.
+ *
+ * @param journal       journal
+ */
+void app_journal_request_flush (app_journal_t * journal);
+
+#endif /* APP_JOURNAL_H */
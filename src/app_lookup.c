@@ -0,0 +1,93 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#include "app_lookup.h"
+
+#include <string.h>
+
+int app_lookup_check (const app_lookup_t * lookup, const up_device_t * device)
+{
+   uint16_t slot_ix;
+   uint16_t i;
+
+   if (lookup->n_slots != device->n_slots)
+   {
+      return -1;
+   }
+
+   for (slot_ix = 0; slot_ix < device->n_slots; slot_ix++)
+   {
+      const up_slot_t * slot = &device->slots[slot_ix];
+      const uint16_t * base = lookup->param_base;
+
+      if (base[slot_ix + 1] - base[slot_ix] != slot->n_params)
+      {
+         return -1;
+      }
+
+      for (i = 0; i < slot->n_params; i++)
+      {
+         const app_lookup_param_t * entry = &lookup->params[base[slot_ix] + i];
+         const up_param_t * p = &slot->params[i];
+
+         if (
+            entry->ix != p->ix || entry->size != (p->bitlength + 7) / 8 ||
+            entry->datatype != p->datatype)
+         {
+            return -1;
+         }
+      }
+   }
+
+   return 0;
+}
+
+bool app_lookup_in_range (const app_lookup_param_t * param, const void * value)
+{
+   union
+   {
+      int8_t i8;
+      int16_t i16;
+      int32_t i32;
+      uint8_t u8;
+      uint16_t u16;
+      uint32_t u32;
+      float f;
+   } v;
+
+   if (!(param->flags & APP_LOOKUP_RANGE))
+   {
+      return true;
+   }
+
+   memcpy (&v, value, param->size);
+
+   switch (param->datatype)
+   {
+   case UP_DTYPE_INT8:
+      return v.i8 >= param->min.i && v.i8 <= param->max.i;
+   case UP_DTYPE_INT16:
+      return v.i16 >= param->min.i && v.i16 <= param->max.i;
+   case UP_DTYPE_INT32:
+      return v.i32 >= param->min.i && v.i32 <= param->max.i;
+   case UP_DTYPE_UINT8:
+      return v.u8 >= param->min.u && v.u8 <= param->max.u;
+   case UP_DTYPE_UINT16:
+      return v.u16 >= param->min.u && v.u16 <= param->max.u;
+   case UP_DTYPE_UINT32:
+      return v.u32 >= param->min.u && v.u32 <= param->max.u;
+   case UP_DTYPE_REAL32:
+      return v.f >= param->min.f && v.f <= param->max.f;
+   default:
+      return true;
+   }
+}
@@ -0,0 +1,114 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/**
+ * Flat lookup tables for the device model.
+ *
+ * The tables are generated from the model by tools/genlookup.py and
+ * are const, so they are placed in flash on targets that execute from
+ * flash. A (slot, parameter) pair is resolved with one bounds check
+ * and one array access instead of walking up_device. Entries also
+ * carry the value range and persistence from the model.
+ *
+ * The generator assigns up_vars indices in the order used by upgen.
+ * Check the tables against the device with app_lookup_check() before
+ * use.
+ */
+
+#ifndef APP_LOOKUP_H
+#define APP_LOOKUP_H
+
+#include "up_api.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define APP_LOOKUP_RANGE      (1 << 0) /**< min and max are valid */
+#define APP_LOOKUP_PERSISTENT (1 << 1) /**< Parameter is persistent */
+
+typedef union app_lookup_limit
+{
+   int32_t i;
+   uint32_t u;
+   float f;
+} app_lookup_limit_t;
+
+typedef struct app_lookup_param
+{
+   uint16_t ix;      /**< Index into up_vars */
+   uint8_t size;     /**< Value size in bytes */
+   uint8_t datatype; /**< up_dtype_t */
+   uint8_t flags;    /**< APP_LOOKUP_RANGE, APP_LOOKUP_PERSISTENT */
+   app_lookup_limit_t min;
+   app_lookup_limit_t max;
+} app_lookup_param_t;
+
+/**
+ * Lookup tables for one device. Parameters of slot n are found at
+ * param_base[n] up to, but not including, param_base[n + 1].
+ */
+typedef struct app_lookup
+{
+   uint16_t n_slots;
+   const uint16_t * param_base;
+   const app_lookup_param_t * params;
+} app_lookup_t;
+
+/** Tables generated from the device model */
+extern const app_lookup_t model_lookup;
+
+/**
+ * Check that lookup tables match a device model.
+ *
+ * @param lookup        lookup tables
+ * @param device        device model
+ * @return 0 if the tables match, -1 otherwise
+ */
+int app_lookup_check (const app_lookup_t * lookup, const up_device_t * device);
+
+/**
+ * Check that a value is within the range of a parameter. Parameters
+ * without range accept any value.
+ *
+ * @param param         parameter entry
+ * @param value         value, param->size bytes
+ * @return true if the value is within range
+ */
+bool app_lookup_in_range (const app_lookup_param_t * param, const void * value);
+
+/**
+ * Get parameter entry.
+ *
+ * @param lookup        lookup tables
+ * @param slot_ix       slot index
+ * @param param_ix      parameter index within slot
+ * @return parameter entry, or NULL if there is no such parameter
+ */
+static inline const app_lookup_param_t * app_lookup_param (
+   const app_lookup_t * lookup,
+   uint16_t slot_ix,
+   uint16_t param_ix)
+{
+   const uint16_t * base = lookup->param_base;
+
+   if (
+      slot_ix >= lookup->n_slots ||
+      param_ix >= base[slot_ix + 1] - base[slot_ix])
+   {
+      return NULL;
+   }
+
+   return &lookup->params[base[slot_ix] + param_ix];
+}
+
+#endif /* APP_LOOKUP_H */
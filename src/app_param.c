@@ -0,0 +1,193 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#include "app_param.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static size_t param_length (const up_param_t * p)
+{
+   return (p->bitlength + 7) / 8;
+}
+
+int app_param_batch_init (
+   app_param_batch_t * batch,
+   const up_device_t * device,
+   app_param_write_t * reqs,
+   uint16_t max_reqs)
+{
+   memset (batch, 0, sizeof (*batch));
+   batch->device = device;
+   batch->reqs = reqs;
+   batch->max_reqs = max_reqs;
+
+   if (max_reqs == 0)
+   {
+      return -1;
+   }
+
+   return 0;
+}
+
+static const up_param_t * find_param (
+   const up_device_t * device,
+   uint16_t slot_ix,
+   uint16_t param_ix)
+{
+   if (slot_ix >= device->n_slots)
+   {
+      return NULL;
+   }
+
+   if (param_ix >= device->slots[slot_ix].n_params)
+   {
+      return NULL;
+   }
+
+   return &device->slots[slot_ix].params[param_ix];
+}
+
+void app_param_batch_set_lookup (
+   app_param_batch_t * batch,
+   const app_lookup_t * lookup,
+   bool check_range)
+{
+   batch->lookup = lookup;
+   batch->check_range = check_range;
+}
+
+void app_param_batch_set_transport (
+   app_param_batch_t * batch,
+   app_transport_t * transport)
+{
+   batch->transport = transport;
+}
+
+/**
+ * Validate a request. Partial writes are not range checked.
+ *
+ * @return index into up_vars, or -1 if the request is invalid
+ */
+static int validate (
+   app_param_batch_t * batch,
+   const app_param_write_t * req,
+   const binary_t * data)
+{
+   const app_lookup_param_t * entry;
+   const up_param_t * p;
+
+   if (batch->lookup == NULL)
+   {
+      p = find_param (batch->device, req->slot_ix, req->param_ix);
+      if (p == NULL || data->dataLength > param_length (p))
+      {
+         return -1;
+      }
+      return p->ix;
+   }
+
+   entry = app_lookup_param (batch->lookup, req->slot_ix, req->param_ix);
+   if (entry == NULL || data->dataLength > entry->size)
+   {
+      return -1;
+   }
+
+   if (
+      batch->check_range && data->dataLength == entry->size &&
+      !app_lookup_in_range (entry, data->data))
+   {
+      batch->n_out_of_range++;
+      return -1;
+   }
+
+   return entry->ix;
+}
+
+/**
+ * Release values of the last batch not yet applied.
+ */
+static void release (app_param_batch_t * batch)
+{
+   uint16_t i;
+
+   for (i = 0; i < batch->n_reqs; i++)
+   {
+      free (batch->reqs[i].value);
+      batch->reqs[i].value = NULL;
+   }
+}
+
+uint16_t app_param_batch_get (app_param_batch_t * batch, up_t * up)
+{
+   app_param_write_t * req;
+   binary_t data;
+   uint32_t start;
+   int error;
+   int ix;
+
+   release (batch);
+   batch->n_reqs = 0;
+
+   while (batch->n_reqs < batch->max_reqs)
+   {
+      req = &batch->reqs[batch->n_reqs];
+      start = app_transport_begin();
+      error =
+         up_param_get_write_req (up, &req->slot_ix, &req->param_ix, &data);
+      if (batch->transport != NULL)
+      {
+         /* An empty queue is not an error */
+         app_transport_end (
+            batch->transport,
+            APP_TRANSPORT_PARAM_GET,
+            start,
+            (error == 0) ? data.dataLength : 0,
+            0);
+      }
+
+      if (error != 0)
+      {
+         break;
+      }
+
+      ix = validate (batch, req, &data);
+      if (ix < 0)
+      {
+         batch->n_rejected++;
+         free (data.data);
+         continue;
+      }
+
+      req->ix = (uint16_t)ix;
+      req->length = data.dataLength;
+      req->value = data.data;
+
+      batch->n_reqs++;
+      batch->n_writes++;
+   }
+
+   return batch->n_reqs;
+}
+
+void app_param_batch_apply (app_param_batch_t * batch, up_signal_info_t * vars)
+{
+   uint16_t i;
+
+   for (i = 0; i < batch->n_reqs; i++)
+   {
+      const app_param_write_t * req = &batch->reqs[i];
+      memcpy (vars[req->ix].value, req->value, req->length);
+   }
+
+   release (batch);
+}
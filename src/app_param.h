@@ -0,0 +1,122 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/**
+ * Batched parameter writes.
+ *
+ * Retrieves pending parameter write requests in batches into a
+ * caller-provided request array, so that a burst of writes is applied
+ * to up_vars after the whole batch is fetched. Values stay in the
+ * buffers returned by the core until they are applied. Request
+ * indices and value lengths are validated against the device model
+ * before the values are applied. With lookup tables,
+ * requests are resolved without walking the device model, and values
+ * outside the parameter range can optionally be rejected. The core
+ * has already accepted a write when it is retrieved, so a rejected
+ * write is only counted and the parameter keeps its previous value.
+ */
+
+#ifndef APP_PARAM_H
+#define APP_PARAM_H
+
+#include "app_lookup.h"
+#include "app_transport.h"
+#include "up_api.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct app_param_write
+{
+   uint16_t slot_ix;
+   uint16_t param_ix;
+   uint16_t ix;     /**< Index into up_vars */
+   uint16_t length; /**< Value length in bytes */
+   uint8_t * value; /**< Value, owned by the batch until applied */
+} app_param_write_t;
+
+typedef struct app_param_batch
+{
+   const up_device_t * device;
+   const app_lookup_t * lookup; /**< Lookup tables, or NULL */
+   bool check_range;            /**< Reject values out of range */
+   app_transport_t * transport; /**< Transport statistics, or NULL */
+   app_param_write_t * reqs;
+   uint16_t max_reqs;
+   uint16_t n_reqs;         /**< Requests retrieved by last get */
+   uint32_t n_writes;       /**< Total number of valid requests */
+   uint32_t n_rejected;     /**< Requests with invalid index, length or value */
+   uint32_t n_out_of_range; /**< Rejected requests with value out of range */
+} app_param_batch_t;
+
+/**
+ * Initialise batch with caller-provided storage.
+ *
+ * @param batch         batch
+ * @param device        device model
+ * @param reqs          request array
+ * @param max_reqs      number of entries in request array
+ * @return 0 on success, -1 if the request array is empty
+ */
+int app_param_batch_init (
+   app_param_batch_t * batch,
+   const up_device_t * device,
+   app_param_write_t * reqs,
+   uint16_t max_reqs);
+
+/**
+ * Use lookup tables to resolve requests. The tables must match the
+ * device model, see app_lookup_check().
+ *
+ * @param batch         batch
+ * @param lookup        lookup tables, or NULL to use the device model
+ * @param check_range   reject values outside the parameter range
+ */
+void app_param_batch_set_lookup (
+   app_param_batch_t * batch,
+   const app_lookup_t * lookup,
+   bool check_range);
+
+/**
+ * Record each up_param_get_write_req() call as a PARAM_GET operation
+ * in the transport statistics, including the final call that finds
+ * no request pending.
+ *
+ * @param batch         batch
+ * @param transport     transport statistics, or NULL
+ */
+void app_param_batch_set_transport (
+   app_param_batch_t * batch,
+   app_transport_t * transport);
+
+/**
+ * Retrieve pending parameter write requests. Stops when no request is
+ * pending or the batch is full; call again until 0 is returned to
+ * drain all requests. Invalid requests are counted and dropped.
+ *
+ * @param batch         batch
+ * @param up            u-phy instance
+ * @return number of requests retrieved
+ */
+uint16_t app_param_batch_get (app_param_batch_t * batch, up_t * up);
+
+/**
+ * Copy values of retrieved requests to their parameters and release
+ * them. Must be called after each get.
+ *
+ * @param batch         batch
+ * @param vars          signal and parameter values
+ */
+void app_param_batch_apply (app_param_batch_t * batch, up_signal_info_t * vars);
+
+#endif /* APP_PARAM_H */
@@ -0,0 +1,213 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#include "app_recorder.h"
+
+#include "osal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Minimum room for event data, e.g. parameter values */
+#define MIN_DATA_SIZE 16
+
+static char signal_format (const app_image_signal_t * s)
+{
+   switch (s->datatype)
+   {
+   case UP_DTYPE_INT8:
+      return 'b';
+   case UP_DTYPE_INT16:
+      return 'h';
+   case UP_DTYPE_INT32:
+      return 'i';
+   case UP_DTYPE_UINT8:
+      return 'B';
+   case UP_DTYPE_UINT16:
+      return 'H';
+   case UP_DTYPE_UINT32:
+      return 'I';
+   case UP_DTYPE_REAL32:
+      return 'f';
+   default:
+      /* Raw bytes */
+      return 's';
+   }
+}
+
+static app_record_t * record_next (app_recorder_t * r)
+{
+   app_record_t * record;
+   uint32_t now = os_get_current_time_us();
+
+   /* Extend 32-bit time, assuming records are less than ~71 minutes
+      apart */
+   r->time += now - r->last;
+   r->last = now;
+
+   record = (app_record_t *)(r->records + (size_t)r->next * r->record_size);
+   if (++r->next == r->n_records)
+   {
+      r->next = 0;
+      r->full = true;
+   }
+
+   record->time = r->time;
+   memset (record->reserved, 0, sizeof (record->reserved));
+   return record;
+}
+
+int app_recorder_init (
+   app_recorder_t * r,
+   const app_image_t * image,
+   uint32_t hash,
+   uint32_t n_records)
+{
+   uint64_t data_size = (uint64_t)image->inputs.size + image->outputs.size;
+
+   if (data_size < MIN_DATA_SIZE)
+   {
+      data_size = MIN_DATA_SIZE;
+   }
+
+   memset (r, 0, sizeof (*r));
+   if (data_size > UINT32_MAX - sizeof (app_record_t) - 7)
+   {
+      return -1;
+   }
+
+   r->image = image;
+   r->hash = hash;
+   r->n_records = n_records;
+   r->record_size = (sizeof (app_record_t) + data_size + 7) & ~7u;
+   r->records = calloc (n_records, r->record_size);
+   r->last = os_get_current_time_us();
+   r->time = r->last;
+
+   return (r->records == NULL || n_records == 0) ? -1 : 0;
+}
+
+void app_recorder_cycle (app_recorder_t * r, uint32_t status)
+{
+   app_record_t * record = record_next (r);
+   uint8_t * data = (uint8_t *)(record + 1);
+
+   record->type = APP_RECORD_CYCLE;
+   record->value = status;
+   record->length = r->image->inputs.size + r->image->outputs.size;
+   app_image_pack (r->image, &r->image->inputs, data);
+   app_image_pack (
+      r->image,
+      &r->image->outputs,
+      data + r->image->inputs.size);
+}
+
+void app_recorder_event (
+   app_recorder_t * r,
+   app_record_type_t type,
+   uint32_t value,
+   const void * data,
+   uint16_t length)
+{
+   app_record_t * record = record_next (r);
+   uint32_t max_length = r->record_size - sizeof (app_record_t);
+
+   record->type = type;
+   record->value = value;
+   record->length = (length < max_length) ? length : max_length;
+   if (record->length > 0)
+   {
+      memcpy (record + 1, data, record->length);
+   }
+}
+
+static int write_signals (
+   FILE * f,
+   uint8_t section_id,
+   const app_image_section_t * section)
+{
+   const app_image_signal_t * s;
+   char name[256];
+   uint8_t len;
+   char format;
+   uint16_t i;
+
+   for (i = 0; i < section->n_signals; i++)
+   {
+      s = &section->signals[i];
+      len = (uint8_t)snprintf (name, sizeof (name), "%s.%s", s->slot, s->name);
+      format = signal_format (s);
+      if (
+         fwrite (&section_id, 1, 1, f) != 1 ||
+         fwrite (&format, 1, 1, f) != 1 ||
+         fwrite (&s->size, sizeof (s->size), 1, f) != 1 ||
+         fwrite (&s->offset, sizeof (s->offset), 1, f) != 1 ||
+         fwrite (&len, 1, 1, f) != 1 || fwrite (name, 1, len, f) != len)
+      {
+         return -1;
+      }
+   }
+
+   return 0;
+}
+
+int app_recorder_dump (const app_recorder_t * r, const char * path)
+{
+   const app_image_t * image = r->image;
+   app_recorder_header_t header;
+   uint32_t n = r->full ? r->n_records : r->next;
+   uint32_t ix = r->full ? r->next : 0;
+   uint32_t i;
+   int error;
+   FILE * f;
+
+   memset (&header, 0, sizeof (header));
+   memcpy (header.magic, APP_RECORDER_MAGIC, sizeof (header.magic));
+   header.version = APP_RECORDER_VERSION;
+   header.record_size = r->record_size;
+   header.n_records = n;
+   header.hash = r->hash;
+   header.inputs_size = image->inputs.size;
+   header.inputs_status_offset = image->inputs.status_offset;
+   header.outputs_size = image->outputs.size;
+   header.outputs_status_offset = image->outputs.status_offset;
+   header.n_signals = image->inputs.n_signals + image->outputs.n_signals;
+
+   f = fopen (path, "wb");
+   if (f == NULL)
+   {
+      return -1;
+   }
+
+   error = fwrite (&header, sizeof (header), 1, f) != 1 ||
+           write_signals (f, 0, &image->inputs) != 0 ||
+           write_signals (f, 1, &image->outputs) != 0;
+
+   /* Oldest record first */
+   for (i = 0; i < n && !error; i++)
+   {
+      error = fwrite (
+                 r->records + (size_t)ix * r->record_size,
+                 r->record_size,
+                 1,
+                 f) != 1;
+      ix = (ix + 1 == r->n_records) ? 0 : ix + 1;
+   }
+
+   if (fclose (f) != 0)
+   {
+      error = 1;
+   }
+
+   return error ? -1 : (int)n;
+}
@@ -0,0 +1,146 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/**
+ * Flight recorder.
+ *
+ * Keeps the most recent records of process data and events in a ring
+ * buffer of fixed-size records. A cycle record holds the packed input
+ * and output images and the device status word; event records hold
+ * status changes, parameter writes and error codes. All records are
+ * stamped with a monotonic 64-bit time in microseconds.
+ *
+ * Recording never allocates, locks or blocks; a cycle costs packing
+ * the process image into the ring. The recorder has a single writer
+ * and must be recorded to and dumped from the same thread.
+ *
+ * A dump is a binary file with a header, the process image layout
+ * and the records from oldest to newest. tools/recorder2csv.py
+ * decodes a dump to CSV.
+ */
+
+#ifndef APP_RECORDER_H
+#define APP_RECORDER_H
+
+#include "app_image.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define APP_RECORDER_MAGIC   "UPFR"
+#define APP_RECORDER_VERSION 2
+
+typedef enum app_record_type
+{
+   APP_RECORD_CYCLE = 1,
+   APP_RECORD_STATUS,
+   APP_RECORD_PARAM,
+   APP_RECORD_ERROR,
+} app_record_type_t;
+
+/**
+ * Record header, followed by length bytes of data.
+ */
+typedef struct app_record
+{
+   uint64_t time;   /**< Monotonic time in us */
+   uint32_t value;  /**< Status word, error code or slot and param */
+   uint32_t length; /**< Size of data */
+   uint8_t type;    /**< app_record_type_t */
+   uint8_t reserved[7];
+} app_record_t;
+
+/**
+ * Dump file header, followed by the signal table and the records.
+ * Each signal table entry is a section (0 for inputs, 1 for outputs),
+ * a Python struct format character, a 16-bit size, a 32-bit offset
+ * and a name prefixed by its 8-bit length. All values are in host
+ * byte order.
+ */
+typedef struct app_recorder_header
+{
+   char magic[4];
+   uint16_t version;
+   uint16_t reserved;
+   uint32_t record_size;
+   uint32_t n_records;
+   uint32_t hash; /**< Device configuration hash */
+   uint32_t inputs_size;
+   uint32_t inputs_status_offset;
+   uint32_t outputs_size;
+   uint32_t outputs_status_offset;
+   uint32_t n_signals;
+} app_recorder_header_t;
+
+typedef struct app_recorder
+{
+   const app_image_t * image;
+   uint32_t hash;
+   uint8_t * records;
+   uint32_t n_records;   /**< Capacity in records */
+   uint32_t record_size; /**< Size of record including header */
+   uint32_t next;        /**< Index of next record */
+   bool full;            /**< All records written at least once */
+   uint64_t time;        /**< Time of last record in us */
+   uint32_t last;        /**< Time of last record, 32-bit */
+} app_recorder_t;
+
+/**
+ * Initialise flight recorder.
+ *
+ * @param r             flight recorder
+ * @param image         process image to record
+ * @param hash          device configuration hash
+ * @param n_records     number of records to keep
+ * @return 0 on success, -1 if the process image is too large or on
+ *         allocation failure
+ */
+int app_recorder_init (
+   app_recorder_t * r,
+   const app_image_t * image,
+   uint32_t hash,
+   uint32_t n_records);
+
+/**
+ * Record inputs and outputs of the current cycle.
+ *
+ * @param r             flight recorder
+ * @param status        device status word
+ */
+void app_recorder_cycle (app_recorder_t * r, uint32_t status);
+
+/**
+ * Record an event. Data not fitting in a record is truncated.
+ *
+ * @param r             flight recorder
+ * @param type          record type
+ * @param value         event value
+ * @param data          event data, may be NULL if length is 0
+ * @param length        size of data
+ */
+void app_recorder_event (
+   app_recorder_t * r,
+   app_record_type_t type,
+   uint32_t value,
+   const void * data,
+   uint16_t length);
+
+/**
+ * Write recorded history to file.
+ *
+ * @param r             flight recorder
+ * @param path          file to write
+ * @return number of records written, or -1 on error
+ */
+int app_recorder_dump (const app_recorder_t * r, const char * path);
+
+#endif /* APP_RECORDER_H */
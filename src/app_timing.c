@@ -0,0 +1,229 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#include "app_timing.h"
+
+#include "osal.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#define SUB_BUCKETS (1u << APP_HISTOGRAM_SUB_BITS)
+
+static uint32_t msb (uint32_t value)
+{
+#if defined(__GNUC__)
+   return 31 - __builtin_clz (value);
+#else
+   uint32_t n = 0;
+   while (value >>= 1)
+   {
+      n++;
+   }
+   return n;
+#endif
+}
+
+static uint32_t bucket_index (uint32_t value)
+{
+   uint32_t shift;
+   uint32_t ix;
+
+   /* Values below 2 * SUB_BUCKETS are stored exactly */
+   if (value < 2 * SUB_BUCKETS)
+   {
+      return value;
+   }
+
+   shift = msb (value) - APP_HISTOGRAM_SUB_BITS;
+   ix = shift * SUB_BUCKETS + (value >> shift);
+   if (ix >= APP_HISTOGRAM_BUCKETS)
+   {
+      ix = APP_HISTOGRAM_BUCKETS - 1;
+   }
+
+   return ix;
+}
+
+static uint32_t bucket_upper (uint32_t ix)
+{
+   uint32_t shift;
+
+   if (ix < 2 * SUB_BUCKETS)
+   {
+      return ix;
+   }
+
+   shift = ix / SUB_BUCKETS - 1;
+   return (((ix % SUB_BUCKETS) + SUB_BUCKETS + 1) << shift) - 1;
+}
+
+void app_histogram_reset (app_histogram_t * h)
+{
+   memset (h, 0, sizeof (*h));
+   h->min = UINT32_MAX;
+}
+
+void app_histogram_record (app_histogram_t * h, uint32_t value)
+{
+   h->buckets[bucket_index (value)]++;
+   h->sum += value;
+   if (value < h->min)
+   {
+      h->min = value;
+   }
+   if (value > h->max)
+   {
+      h->max = value;
+   }
+   h->count++;
+}
+
+uint32_t app_histogram_percentile (const app_histogram_t * h, uint32_t permille)
+{
+   uint64_t target;
+   uint64_t seen = 0;
+   uint32_t ix;
+
+   if (h->count == 0)
+   {
+      return 0;
+   }
+
+   target = ((uint64_t)h->count * permille + 999) / 1000;
+   for (ix = 0; ix < APP_HISTOGRAM_BUCKETS; ix++)
+   {
+      seen += h->buckets[ix];
+      if (seen >= target)
+      {
+         /* Never report more than the observed maximum. The last
+            bucket is unbounded. */
+         uint32_t upper = bucket_upper (ix);
+         if (ix == APP_HISTOGRAM_BUCKETS - 1 || upper > h->max)
+         {
+            return h->max;
+         }
+         return upper;
+      }
+   }
+
+   return h->max;
+}
+
+void app_timing_init (app_timing_t * t, const char * name, uint32_t budget)
+{
+   memset (t, 0, sizeof (*t));
+   t->name = name;
+   t->budget = budget;
+   app_histogram_reset (&t->exec);
+   app_histogram_reset (&t->interval);
+}
+
+uint32_t app_timing_begin (app_timing_t * t)
+{
+   uint32_t now = os_get_current_time_us();
+
+   if (t->started)
+   {
+      app_histogram_record (&t->interval, now - t->last_start);
+   }
+
+   t->started = true;
+   t->last_start = now;
+   return now;
+}
+
+void app_timing_end (app_timing_t * t, uint32_t start)
+{
+   uint32_t elapsed = os_get_current_time_us() - start;
+
+   app_histogram_record (&t->exec, elapsed);
+   if (t->budget != 0 && elapsed > t->budget)
+   {
+      t->overruns++;
+   }
+}
+
+void app_histogram_show (const char * name, const app_histogram_t * h)
+{
+   if (h->count == 0)
+   {
+      printf ("  %-8s no samples\n", name);
+      return;
+   }
+
+   printf (
+      "  %-8s n=%" PRIu32 " min=%" PRIu32 " mean=%" PRIu32 " p50=%" PRIu32
+      " p90=%" PRIu32 " p99=%" PRIu32 " p99.9=%" PRIu32 " max=%" PRIu32
+      " us\n",
+      name,
+      h->count,
+      h->min,
+      (uint32_t)(h->sum / h->count),
+      app_histogram_percentile (h, 500),
+      app_histogram_percentile (h, 900),
+      app_histogram_percentile (h, 990),
+      app_histogram_percentile (h, 999),
+      h->max);
+}
+
+uint32_t app_timing_jitter (const app_timing_t * t)
+{
+   if (t->interval.count < 2)
+   {
+      return 0;
+   }
+
+   return t->interval.max - t->interval.min;
+}
+
+void app_timing_show (const app_timing_t * t)
+{
+   printf (
+      "%s: overruns=%" PRIu32 " jitter=%" PRIu32 " us\n",
+      t->name,
+      t->overruns,
+      app_timing_jitter (t));
+   app_histogram_show ("exec", &t->exec);
+   app_histogram_show ("interval", &t->interval);
+}
+
+void app_histogram_write_json (const app_histogram_t * h, FILE * f)
+{
+   fprintf (
+      f,
+      "{\"count\": %" PRIu32 ", \"min\": %" PRIu32 ", \"mean\": %" PRIu32
+      ", \"p50\": %" PRIu32 ", \"p90\": %" PRIu32 ", \"p99\": %" PRIu32
+      ", \"p999\": %" PRIu32 ", \"max\": %" PRIu32 "}",
+      h->count,
+      (h->count > 0) ? h->min : 0,
+      (h->count > 0) ? (uint32_t)(h->sum / h->count) : 0,
+      app_histogram_percentile (h, 500),
+      app_histogram_percentile (h, 900),
+      app_histogram_percentile (h, 990),
+      app_histogram_percentile (h, 999),
+      h->max);
+}
+
+void app_timing_write_json (const app_timing_t * t, FILE * f)
+{
+   fprintf (
+      f,
+      "{\"overruns\": %" PRIu32 ", \"jitter_us\": %" PRIu32
+      ", \"exec_us\": ",
+      t->overruns,
+      app_timing_jitter (t));
+   app_histogram_write_json (&t->exec, f);
+   fprintf (f, ", \"interval_us\": ");
+   app_histogram_write_json (&t->interval, f);
+   fprintf (f, "}");
+}
@@ -0,0 +1,149 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/**
+ * Callback timing instrumentation.
+ *
+ * Execution time and inter-arrival time of a callback are recorded in
+ * fixed-size log-linear histograms (8 sub-buckets per power of two,
+ * i.e. at most 12.5% relative error). Recording is a handful of
+ * integer operations and never blocks. Each timing object must only
+ * be updated from one thread; it may be read from any thread.
+ */
+
+#ifndef APP_TIMING_H
+#define APP_TIMING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Values up to 2^24 us (~16 s) are resolved, larger values are
+   counted in the last bucket */
+#define APP_HISTOGRAM_SUB_BITS 3
+#define APP_HISTOGRAM_MAX_BITS 24
+#define APP_HISTOGRAM_BUCKETS                                                  \
+   ((2 << APP_HISTOGRAM_SUB_BITS) +                                            \
+    (APP_HISTOGRAM_MAX_BITS - APP_HISTOGRAM_SUB_BITS - 1) *                    \
+       (1 << APP_HISTOGRAM_SUB_BITS))
+
+typedef struct app_histogram
+{
+   uint32_t count;
+   uint32_t min;
+   uint32_t max;
+   uint64_t sum;
+   uint32_t buckets[APP_HISTOGRAM_BUCKETS];
+} app_histogram_t;
+
+typedef struct app_timing
+{
+   const char * name;
+   uint32_t budget;   /**< Execution time budget in us, 0 if none */
+   uint32_t overruns; /**< Number of executions exceeding budget */
+   uint32_t last_start;
+   bool started;
+   app_histogram_t exec;     /**< Execution time in us */
+   app_histogram_t interval; /**< Time between calls in us */
+} app_timing_t;
+
+/**
+ * Reset histogram.
+ *
+ * @param h             histogram
+ */
+void app_histogram_reset (app_histogram_t * h);
+
+/**
+ * Record a value.
+ *
+ * @param h             histogram
+ * @param value         value to record
+ */
+void app_histogram_record (app_histogram_t * h, uint32_t value);
+
+/**
+ * Get value at percentile. The returned value is the upper bound of
+ * the bucket holding the percentile.
+ *
+ * @param h             histogram
+ * @param permille      percentile in 1/10 percent (e.g. 999 for 99.9%)
+ * @return value at percentile, or 0 if histogram is empty
+ */
+uint32_t app_histogram_percentile (const app_histogram_t * h, uint32_t permille);
+
+/**
+ * Print histogram summary on one line.
+ *
+ * @param name          name of histogram
+ * @param h             histogram
+ */
+void app_histogram_show (const char * name, const app_histogram_t * h);
+
+/**
+ * Write histogram summary as a JSON object.
+ *
+ * @param h             histogram
+ * @param f             output stream
+ */
+void app_histogram_write_json (const app_histogram_t * h, FILE * f);
+
+/**
+ * Initialise timing object.
+ *
+ * @param t             timing object
+ * @param name          name used when printing
+ * @param budget        execution time budget in us, 0 if none
+ */
+void app_timing_init (app_timing_t * t, const char * name, uint32_t budget);
+
+/**
+ * Record start of callback.
+ *
+ * @param t             timing object
+ * @return start time, to be passed to app_timing_end()
+ */
+uint32_t app_timing_begin (app_timing_t * t);
+
+/**
+ * Record end of callback.
+ *
+ * @param t             timing object
+ * @param start         start time from app_timing_begin()
+ */
+void app_timing_end (app_timing_t * t, uint32_t start);
+
+/**
+ * Get worst-case jitter, i.e. the difference between the longest and
+ * the shortest time between calls.
+ *
+ * @param t             timing object
+ * @return jitter in us, or 0 if fewer than two intervals recorded
+ */
+uint32_t app_timing_jitter (const app_timing_t * t);
+
+/**
+ * Print timing statistics.
+ *
+ * @param t             timing object
+ */
+void app_timing_show (const app_timing_t * t);
+
+/**
+ * Write timing statistics as a JSON object.
+ *
+ * @param t             timing object
+ * @param f             output stream
+ */
+void app_timing_write_json (const app_timing_t * t, FILE * f);
+
+#endif /* APP_TIMING_H */
@@ -0,0 +1,101 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#include "app_transport.h"
+
+#include "osal.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+static const char * const op_names[APP_TRANSPORT_NUM_OPS] = {
+   [APP_TRANSPORT_READ_OUTPUTS] = "read_outputs",
+   [APP_TRANSPORT_WRITE_INPUTS] = "write_inputs",
+   [APP_TRANSPORT_PARAM_GET] = "param_get",
+};
+
+void app_transport_init (app_transport_t * t, const char * name)
+{
+   int i;
+
+   memset (t, 0, sizeof (*t));
+   t->name = name;
+   for (i = 0; i < APP_TRANSPORT_NUM_OPS; i++)
+   {
+      app_histogram_reset (&t->op[i].rtt);
+   }
+}
+
+uint32_t app_transport_begin (void)
+{
+   return os_get_current_time_us();
+}
+
+void app_transport_end (
+   app_transport_t * t,
+   app_transport_op_t op,
+   uint32_t start,
+   uint32_t data_bytes,
+   int error)
+{
+   app_transport_op_stats_t * s = &t->op[op];
+
+   app_histogram_record (&s->rtt, os_get_current_time_us() - start);
+   s->calls++;
+   s->data_bytes += data_bytes;
+   if (error != 0)
+   {
+      s->errors++;
+   }
+}
+
+void app_transport_show (const app_transport_t * t)
+{
+   const app_transport_op_stats_t * s;
+   int i;
+
+   printf ("Transport %s:\n", t->name);
+   for (i = 0; i < APP_TRANSPORT_NUM_OPS; i++)
+   {
+      s = &t->op[i];
+      printf (
+         "%s: calls=%" PRIu32 " errors=%" PRIu32 " data_bytes=%" PRIu64 "\n",
+         op_names[i],
+         s->calls,
+         s->errors,
+         s->data_bytes);
+      app_histogram_show ("rtt", &s->rtt);
+   }
+}
+
+void app_transport_write_json (const app_transport_t * t, FILE * f)
+{
+   const app_transport_op_stats_t * s;
+   int i;
+
+   fprintf (f, "{\"name\": \"%s\"", t->name);
+   for (i = 0; i < APP_TRANSPORT_NUM_OPS; i++)
+   {
+      s = &t->op[i];
+      fprintf (
+         f,
+         ", \"%s\": {\"calls\": %" PRIu32 ", \"errors\": %" PRIu32
+         ", \"data_bytes\": %" PRIu64 ", \"rtt_us\": ",
+         op_names[i],
+         s->calls,
+         s->errors,
+         s->data_bytes);
+      app_histogram_write_json (&s->rtt, f);
+      fprintf (f, "}");
+   }
+   fprintf (f, "}");
+}
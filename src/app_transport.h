@@ -0,0 +1,103 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/**
+ * Transport statistics.
+ *
+ * Counts the RPC operations issued by the application, the
+ * application data bytes they carry and errors, and records the
+ * round-trip time of each call in a log-linear histogram. In the
+ * client build an operation covers the full request/response exchange
+ * with the core over the transport, so the round-trip time separates
+ * transport and core latency from time spent in the application.
+ * Recording costs one timestamp pair and a histogram update per call
+ * and may be left enabled in production. Statistics must only be
+ * updated from one thread.
+ */
+
+#ifndef APP_TRANSPORT_H
+#define APP_TRANSPORT_H
+
+#include "app_timing.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum app_transport_op
+{
+   APP_TRANSPORT_READ_OUTPUTS,
+   APP_TRANSPORT_WRITE_INPUTS,
+   APP_TRANSPORT_PARAM_GET,
+   APP_TRANSPORT_NUM_OPS,
+} app_transport_op_t;
+
+typedef struct app_transport_op_stats
+{
+   uint32_t calls;
+   uint32_t errors;     /**< Calls returning an error */
+   uint64_t data_bytes; /**< Application data, not bytes on transport */
+   app_histogram_t rtt; /**< Round-trip time in us */
+} app_transport_op_stats_t;
+
+typedef struct app_transport
+{
+   const char * name; /**< Transport, e.g. "tcp:eth0" */
+   app_transport_op_stats_t op[APP_TRANSPORT_NUM_OPS];
+} app_transport_t;
+
+/**
+ * Initialise transport statistics.
+ *
+ * @param t             transport statistics
+ * @param name          transport name used when printing
+ */
+void app_transport_init (app_transport_t * t, const char * name);
+
+/**
+ * Record start of an operation.
+ *
+ * @return start time, to be passed to app_transport_end()
+ */
+uint32_t app_transport_begin (void);
+
+/**
+ * Record end of an operation.
+ *
+ * @param t             transport statistics
+ * @param op            operation
+ * @param start         start time from app_transport_begin()
+ * @param data_bytes    application data bytes, e.g. packed image size
+ * @param error         result of operation, non-zero on error
+ */
+void app_transport_end (
+   app_transport_t * t,
+   app_transport_op_t op,
+   uint32_t start,
+   uint32_t data_bytes,
+   int error);
+
+/**
+ * Print transport statistics.
+ *
+ * @param t             transport statistics
+ */
+void app_transport_show (const app_transport_t * t);
+
+/**
+ * Write transport statistics as a JSON object.
+ *
+ * @param t             transport statistics
+ * @param f             output stream
+ */
+void app_transport_write_json (const app_transport_t * t, FILE * f);
+
+#endif /* APP_TRANSPORT_H */
@@ -0,0 +1,96 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#include "app_triple.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define FRESH 4u
+#define INDEX 3u
+
+int app_triple_init (app_triple_t * tb, size_t size)
+{
+   const size_t align = _Alignof (max_align_t);
+   uint8_t * mem;
+   size_t stride;
+   int i;
+
+   /* Keep at least one byte per buffer so that pointers are distinct,
+      and align each buffer so that it may start with a struct */
+   stride = (size > 0) ? size : 1;
+   stride = (stride + align - 1) / align * align;
+
+   mem = calloc (3, stride);
+   if (mem == NULL)
+   {
+      return -1;
+   }
+
+   for (i = 0; i < 3; i++)
+   {
+      tb->buf[i] = mem + i * stride;
+   }
+
+   tb->size = size;
+   tb->back = 0;
+   atomic_init (&tb->middle, 1);
+   tb->front = 2;
+
+   return 0;
+}
+
+void app_triple_fill (app_triple_t * tb, const uint8_t * data)
+{
+   int i;
+
+   for (i = 0; i < 3; i++)
+   {
+      memcpy (tb->buf[i], data, tb->size);
+   }
+}
+
+void app_triple_publish (app_triple_t * tb)
+{
+   unsigned int old;
+
+   /* Release makes the snapshot visible before the buffer index */
+   old = atomic_exchange_explicit (
+      &tb->middle,
+      tb->back | FRESH,
+      memory_order_acq_rel);
+   tb->back = old & INDEX;
+}
+
+const uint8_t * app_triple_read (app_triple_t * tb, bool * fresh)
+{
+   unsigned int old;
+   bool is_fresh;
+
+   is_fresh = (atomic_load_explicit (&tb->middle, memory_order_relaxed) &
+               FRESH) != 0;
+   if (is_fresh)
+   {
+      old = atomic_exchange_explicit (
+         &tb->middle,
+         tb->front,
+         memory_order_acq_rel);
+      tb->front = old & INDEX;
+   }
+
+   if (fresh != NULL)
+   {
+      *fresh = is_fresh;
+   }
+
+   return tb->buf[tb->front];
+}
@@ -0,0 +1,90 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/**
+ * Wait-free triple buffer.
+ *
+ * Passes complete snapshots from one writer thread to one reader
+ * thread. The writer fills the back buffer and publishes it by
+ * swapping it with the middle buffer; the reader picks up the latest
+ * published buffer by swapping the middle buffer with the front
+ * buffer. Neither side ever blocks or copies more than the snapshot
+ * itself. Intermediate snapshots are dropped if the writer is faster
+ * than the reader.
+ */
+
+#ifndef APP_TRIPLE_H
+#define APP_TRIPLE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct app_triple
+{
+   uint8_t * buf[3];
+   size_t size;
+   atomic_uint middle; /**< Index of middle buffer, and fresh flag */
+   unsigned int back;  /**< Owned by writer */
+   unsigned int front; /**< Owned by reader */
+} app_triple_t;
+
+/**
+ * Initialise triple buffer. All buffers are zeroed and suitably
+ * aligned for any type.
+ *
+ * @param tb            triple buffer
+ * @param size          snapshot size in bytes
+ * @return 0 on success, -1 on allocation failure
+ */
+int app_triple_init (app_triple_t * tb, size_t size);
+
+/**
+ * Set contents of all buffers, e.g. to an initial snapshot. Must not
+ * be called while the buffer is in use.
+ *
+ * @param tb            triple buffer
+ * @param data          snapshot, tb->size bytes
+ */
+void app_triple_fill (app_triple_t * tb, const uint8_t * data);
+
+/**
+ * Get buffer to fill with the next snapshot. Writer only.
+ *
+ * @param tb            triple buffer
+ * @return back buffer
+ */
+static inline uint8_t * app_triple_back (app_triple_t * tb)
+{
+   return tb->buf[tb->back];
+}
+
+/**
+ * Publish the back buffer. Writer only.
+ *
+ * @param tb            triple buffer
+ */
+void app_triple_publish (app_triple_t * tb);
+
+/**
+ * Get latest published snapshot. Reader only. The returned buffer
+ * remains valid until the next call.
+ *
+ * @param tb            triple buffer
+ * @param fresh         set to true if a new snapshot was published
+ *                      since the previous call, may be NULL
+ * @return front buffer
+ */
+const uint8_t * app_triple_read (app_triple_t * tb, bool * fresh);
+
+#endif /* APP_TRIPLE_H */
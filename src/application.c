@@ -16,8 +16,10 @@
 #include "up_api.h"
 #include "up_util.h"
 #include "model.h"
+#include "osal.h"
 
 #include <inttypes.h>
+#include <signal.h>
 #include <stdio.h>
 
 /* Enable synchronous operation mode. In this mode, the device data is
@@ -43,79 +45,715 @@
 #define ENABLE_IO_FILES 0
 #endif
 
-static void get_inputs (void * user_arg)
+/* Enable shared-memory process image. Inputs and outputs are
+   exchanged with other processes through a double-buffered binary
+   image instead of the input and status files. The command file is
+   still polled if ENABLE_IO_FILES is set. This feature is currently
+   available on Linux only. */
+#ifndef ENABLE_PROCESS_IMAGE
+#define ENABLE_PROCESS_IMAGE 0
+#endif
+
+/* Enable change tracking of process data. Input writes, output
+   activation and status file updates are skipped when no signal
+   value or status has changed since the previous cycle. All signals
+   are refreshed every CHANGE_TRACKING_REFRESH_CYCLES cycles. Off by
+   default, as the core then no longer receives inputs every cycle. */
+#ifndef ENABLE_CHANGE_TRACKING
+#define ENABLE_CHANGE_TRACKING 0
+#endif
+
+#ifndef CHANGE_TRACKING_REFRESH_CYCLES
+#define CHANGE_TRACKING_REFRESH_CYCLES 100
+#endif
+
+/* Per-signal overhead of a delta encoded input image, i.e. a 16-bit
+   signal index and the status byte. Used to report the input bytes
+   per cycle a delta encoding would need, with a full image keyframe
+   on every refresh. */
+#define DELTA_RECORD_OVERHEAD 3
+
+/* Enable acquisition thread. Sensors are read and actuators are
+   written by a separate thread at least every ACQUISITION_PERIOD_US
+   microseconds instead of in the fieldbus callbacks. Snapshots of
+   inputs and outputs are passed through wait-free triple buffers, so
+   a slow sensor never delays the fieldbus cycle. */
+#ifndef ENABLE_ACQUISITION_THREAD
+#define ENABLE_ACQUISITION_THREAD 0
+#endif
+
+#ifndef ACQUISITION_PERIOD_US
+#define ACQUISITION_PERIOD_US 1000
+#endif
+
+#ifndef ACQUISITION_THREAD_PRIORITY
+#define ACQUISITION_THREAD_PRIORITY 10
+#endif
+
+#ifndef ACQUISITION_THREAD_STACK_SIZE
+#define ACQUISITION_THREAD_STACK_SIZE 4096
+#endif
+
+/* Maximum age of the input snapshot written to the core. The
+   acquisition thread is woken as soon as the fieldbus thread has
+   taken a snapshot, so the next one is prepared while the previous
+   one is being written. At most one snapshot is pending; if the
+   thread falls behind, inputs older than ACQUISITION_MAX_AGE_US
+   microseconds are written with status cleared. 0 disables the
+   check. */
+#ifndef ACQUISITION_MAX_AGE_US
+#define ACQUISITION_MAX_AGE_US (10 * ACQUISITION_PERIOD_US)
+#endif
+
+/* Enable flight recorder. Inputs, outputs and device status of the
+   last APP_RECORDER_RECORDS cycles are kept in memory together with
+   status changes, parameter writes and errors. The history is dumped
+   to APP_RECORDER_FILE when an error is indicated, when the
+   connection to the core is lost and on request. */
+#ifndef ENABLE_FLIGHT_RECORDER
+#define ENABLE_FLIGHT_RECORDER 0
+#endif
+
+#ifndef APP_RECORDER_RECORDS
+#define APP_RECORDER_RECORDS 1024
+#endif
+
+#ifndef APP_RECORDER_FILE
+#define APP_RECORDER_FILE "/tmp/u-phy-recorder.bin"
+#endif
+
+#include "app_bulk.h"
+#include "app_image.h"
+
+static app_image_t app_image;
+
+#if ENABLE_FLIGHT_RECORDER
+#include "app_recorder.h"
+
+static app_recorder_t app_recorder;
+static uint32_t app_device_status;
+
+#define RECORD_CYCLE() app_recorder_cycle (&app_recorder, app_device_status)
+#define RECORD_EVENT(type, value, data, length)                                \
+   app_recorder_event (&app_recorder, type, value, data, length)
+#else
+#define RECORD_CYCLE()
+#define RECORD_EVENT(type, value, data, length)
+#endif
+
+#if ENABLE_PROCESS_IMAGE
+#include "pimage.h"
+
+static pimage_t * app_pimage;
+#endif
+
+#if ENABLE_CHANGE_TRACKING
+#include "app_dirty.h"
+
+static app_dirty_t app_inputs_dirty;
+static app_dirty_t app_outputs_dirty;
+#endif
+
+#if ENABLE_ACQUISITION_THREAD
+#include "app_timing.h"
+#include "app_triple.h"
+
+/* Process data owned by the acquisition thread */
+static up_data_t acq_data;
+static app_image_t acq_image;
+
+/* Input snapshots start with a header, followed by the packed
+   inputs */
+typedef struct acq_header
+{
+   uint32_t seq;  /**< Snapshot sequence number */
+   uint32_t time; /**< Time of sampling in us */
+   uint32_t reserved[2];
+} acq_header_t;
+
+#define ACQ_EVENT_INPUTS_TAKEN     BIT (0)
+#define ACQ_EVENT_OUTPUTS_RECEIVED BIT (1)
+
+static app_triple_t app_inputs_tb;
+static app_triple_t app_outputs_tb;
+static os_event_t * acq_event;
+
+static struct
+{
+   uint32_t seq;     /**< Sequence number of last snapshot taken */
+   uint32_t reused;  /**< Cycles without a new snapshot */
+   uint32_t dropped; /**< Snapshots overwritten before taken */
+   uint32_t stale;   /**< Cycles with inputs older than max age */
+   app_histogram_t age; /**< Snapshot age when taken, in us */
+} acq_stats;
+#endif
+
+/* Size of the parameter write batch. All pending write requests are
+   retrieved in batches of up to APP_PARAM_BATCH_SIZE requests. */
+#ifndef APP_PARAM_BATCH_SIZE
+#define APP_PARAM_BATCH_SIZE 16
+#endif
+
+/* Resolve parameter writes with the lookup tables generated from the
+   model (model_lookup.c, see tools/genlookup.py) instead of walking
+   up_device. Requires the tables to be built with the application. */
+#ifndef ENABLE_MODEL_LOOKUP
+#define ENABLE_MODEL_LOOKUP 0
+#endif
+
+/* Drop parameter writes with values outside the range given in the
+   model. The controller is not told, as the core has already
+   accepted the write; rejected writes are only counted in the
+   statistics. Requires ENABLE_MODEL_LOOKUP. */
+#ifndef ENABLE_PARAM_RANGE_CHECK
+#define ENABLE_PARAM_RANGE_CHECK 0
+#endif
+
+#if ENABLE_PARAM_RANGE_CHECK && !ENABLE_MODEL_LOOKUP
+#error "ENABLE_PARAM_RANGE_CHECK requires ENABLE_MODEL_LOOKUP"
+#endif
+
+#include "app_param.h"
+
+static app_param_write_t app_param_reqs[APP_PARAM_BATCH_SIZE];
+static app_param_batch_t app_param_batch;
+
+/* Enable journal of parameters marked persistent in the model. Writes
+   are staged by the parameter write callback and appended to
+   APP_JOURNAL_FILE.a or .b by a flush thread every
+   APP_JOURNAL_FLUSH_MS. A file is compacted into the other one when
+   it grows beyond APP_JOURNAL_MAX_SIZE bytes. Values are restored at
+   startup. Requires ENABLE_MODEL_LOOKUP. */
+#ifndef ENABLE_PARAM_JOURNAL
+#define ENABLE_PARAM_JOURNAL 0
+#endif
+
+#ifndef APP_JOURNAL_FILE
+#define APP_JOURNAL_FILE "/tmp/u-phy-params"
+#endif
+
+#ifndef APP_JOURNAL_MAX_SIZE
+#define APP_JOURNAL_MAX_SIZE 4096
+#endif
+
+#ifndef APP_JOURNAL_FLUSH_MS
+#define APP_JOURNAL_FLUSH_MS 1000
+#endif
+
+#ifndef APP_JOURNAL_THREAD_PRIORITY
+#define APP_JOURNAL_THREAD_PRIORITY 2
+#endif
+
+#ifndef APP_JOURNAL_THREAD_STACK_SIZE
+#define APP_JOURNAL_THREAD_STACK_SIZE 4096
+#endif
+
+#if ENABLE_PARAM_JOURNAL
+#if !ENABLE_MODEL_LOOKUP
+#error "ENABLE_PARAM_JOURNAL requires ENABLE_MODEL_LOOKUP"
+#endif
+
+#include "app_journal.h"
+
+static app_journal_t app_journal;
+#endif
+
+/* Enable timing instrumentation of the fieldbus callbacks. Execution
+   time and interval of each callback are recorded in histograms,
+   which are printed by app_show_stats(). */
+#ifndef ENABLE_CYCLE_TIMING
+#define ENABLE_CYCLE_TIMING 1
+#endif
+
+/* Execution time budget of the cyclic callbacks in microseconds.
+   Executions exceeding the budget are counted as overruns. */
+#ifndef APP_CYCLE_BUDGET_US
+#define APP_CYCLE_BUDGET_US 10000
+#endif
+
+#include "app_timing.h"
+#include "app_transport.h"
+
+static app_transport_t app_transport;
+static const char * app_transport_name = "local";
+
+#if ENABLE_CYCLE_TIMING
+typedef enum app_timing_id
+{
+   TIMING_SYNC,
+   TIMING_AVAIL,
+   TIMING_LOOP,
+   TIMING_PARAM_WRITE,
+   TIMING_NUM,
+} app_timing_id_t;
+
+static app_timing_t app_timing[TIMING_NUM];
+
+#define TIMING_BEGIN(id) uint32_t timing_start = app_timing_begin (&app_timing[id])
+#define TIMING_END(id)   app_timing_end (&app_timing[id], timing_start)
+#else
+#define TIMING_BEGIN(id)
+#define TIMING_END(id)
+#endif
+
+/* Worker idle time in milliseconds. With 0, up_worker() is called
+   back-to-back (busy polling). Otherwise, after a call that
+   dispatched no callback, the application thread blocks until
+   app_worker_wake() is called, e.g. from an event interrupt, or until
+   APP_WORKER_IDLE_MS has passed. Without an event interrupt, as on
+   Linux, an event arriving while blocked is handled up to
+   APP_WORKER_IDLE_MS late. Can be changed at runtime with
+   app_set_worker_idle(). */
+#ifndef APP_WORKER_IDLE_MS
+#define APP_WORKER_IDLE_MS 0
+#endif
+
+#define WORKER_EVENT_WAKE BIT (0)
+
+static struct
+{
+   uint32_t idle_ms;
+   os_event_t * event;
+   bool dispatched; /**< Last up_worker() call dispatched a callback */
+   uint32_t start;
+   uint32_t calls;
+   uint32_t busy;     /**< Calls not followed by a wait */
+   uint32_t wakes;    /**< Waits ended by app_worker_wake() */
+   uint32_t timeouts; /**< Waits ended by timeout */
+   uint64_t idle_us;  /**< Total time blocked */
+   app_histogram_t oversleep; /**< Timed wait beyond idle time in us */
+} app_worker = {
+   .idle_ms = APP_WORKER_IDLE_MS,
+};
+
+/* Session state kept across reconnects. The device configuration is
+   fixed for the lifetime of the process, so the inputs of the last
+   session always match the current layout. Inputs are saved when the
+   connection to the core is lost and restored after the device has
+   been set up again, before inputs are latched and written. This is
+   only done when inputs are set by read_sensors() alone; the input
+   file, process image and acquisition thread supply every input when
+   latched, so there is nothing to restore. */
+#define SESSION_RESTORE_INPUTS                                                 \
+   (!ENABLE_IO_FILES && !ENABLE_PROCESS_IMAGE && !ENABLE_ACQUISITION_THREAD)
+
+static struct
+{
+   uint32_t hash;    /**< Device configuration hash */
+   uint8_t * inputs; /**< Inputs at end of last session, or NULL */
+   bool saved;
+   uint32_t lost;       /**< Time connection was lost */
+   uint32_t reconnects; /**< Number of sessions after the first */
+   app_histogram_t reconnect_ms; /**< Time to restore session */
+} app_session;
+
+static volatile sig_atomic_t stats_requested;
+static volatile sig_atomic_t transport_stats_requested;
+static volatile sig_atomic_t recorder_dump_requested;
+
+static struct
+{
+   uint32_t cycles;
+   uint32_t input_writes_skipped;
+   uint32_t output_updates_skipped;
+   uint32_t status_updates_skipped;
+   uint32_t param_batches;
+   uint64_t input_bytes;       /**< Input image bytes written */
+   uint64_t input_delta_bytes; /**< Same, if delta encoded */
+} app_stats;
+
+static bool status_dirty = true;
+
+#if ENABLE_IO_FILES
+#include "cmd_listener.h"
+
+static cmd_listener_t * app_cmd_listener;
+
+static void poll_commands (void)
+{
+   cmd_event_t event;
+   bool pending = false;
+
+   /* Fall back to polling if the listener could not be started */
+   if (app_cmd_listener == NULL)
+   {
+      up_util_poll_cmd_file ("/tmp/u-phy-command.txt");
+      return;
+   }
+
+   while (cmd_listener_get (app_cmd_listener, &event))
+   {
+      pending = true;
+   }
+
+   if (pending)
+   {
+      up_util_poll_cmd_file ("/tmp/u-phy-command.txt");
+   }
+}
+#endif
+
+static void read_outputs (up_t * up)
+{
+   uint32_t start;
+   int error;
+
+   start = app_transport_begin();
+   error = up_read_outputs (up);
+   app_transport_end (
+      &app_transport,
+      APP_TRANSPORT_READ_OUTPUTS,
+      start,
+      app_image.outputs.size,
+      error);
+}
+
+static void write_inputs (up_t * up)
+{
+   uint32_t start;
+   int error;
+
+   start = app_transport_begin();
+   error = up_write_inputs (up);
+   app_transport_end (
+      &app_transport,
+      APP_TRANSPORT_WRITE_INPUTS,
+      start,
+      app_image.inputs.size,
+      error);
+}
+
+static void read_sensors (up_data_t * data)
 {
    /* Use this function to read inputs (sensors) */
 #if 0
-   int status = read_sensor (&up_data.I8.Input_8_bits.value);
-   up_data.I8.Input_8_bits.status = (status == SUCCESS ? UP_STATUS_OK : 0);
+   int status = read_sensor (&data->I8.Input_8_bits.value);
+   data->I8.Input_8_bits.status = (status == SUCCESS ? UP_STATUS_OK : 0);
 #endif
+}
 
-#if ENABLE_IO_FILES
+static void write_actuators (const up_data_t * data)
+{
+   /* Use this function to set outputs (actuators) */
+#if 0
+   if (data->O8.Output_8_bits.status & UP_STATUS_OK)
+   {
+      set_actuator (data->O8.Output_8_bits.value);
+   }
+#endif
+}
+
+#if ENABLE_ACQUISITION_THREAD
+/**
+ * Take latest input snapshot from acquisition thread and wake the
+ * thread to start on the next one. A snapshot is taken at most
+ * once; if no new snapshot has been published the previous one is
+ * written again. Inputs older than ACQUISITION_MAX_AGE_US are
+ * marked as not OK.
+ */
+static void take_inputs (void)
+{
+   const uint8_t * snapshot;
+   const acq_header_t * header;
+   uint32_t age;
+   bool fresh;
+
+   snapshot = app_triple_read (&app_inputs_tb, &fresh);
+   header = (const acq_header_t *)snapshot;
+   age = os_get_current_time_us() - header->time;
+
+   if (fresh)
+   {
+      acq_stats.dropped += header->seq - acq_stats.seq - 1;
+      acq_stats.seq = header->seq;
+      app_histogram_record (&acq_stats.age, age);
+      app_image_unpack (
+         &app_image,
+         &app_image.inputs,
+         snapshot + sizeof (acq_header_t));
+      os_event_set (acq_event, ACQ_EVENT_INPUTS_TAKEN);
+   }
+   else
+   {
+      acq_stats.reused++;
+   }
+
+   if (ACQUISITION_MAX_AGE_US > 0 && age > ACQUISITION_MAX_AGE_US)
+   {
+      acq_stats.stale++;
+      app_bulk_set_var_status (
+         &app_image,
+         &app_image.inputs,
+         0,
+         app_image.inputs.n_signals,
+         (uint8_t)~UP_STATUS_OK,
+         0);
+   }
+}
+#endif
+
+static void get_inputs (void * user_arg)
+{
+#if ENABLE_ACQUISITION_THREAD
+   take_inputs();
+#else
+   read_sensors (&up_data);
+#endif
+
+#if ENABLE_PROCESS_IMAGE
+   const uint8_t * bank;
+   uint32_t token;
+
+   do
+   {
+      bank = pimage_read_begin (app_pimage, PIMAGE_INPUTS, &token);
+      app_image_unpack (&app_image, &app_image.inputs, bank);
+   } while (!pimage_read_end (app_pimage, PIMAGE_INPUTS, token));
+#elif ENABLE_IO_FILES
    up_util_read_input_file ("/tmp/u-phy-input.txt");
 #endif
 }
 
 static void set_outputs (void * user_arg)
 {
-   /* Use this function to set outputs (actuators) */
-#if 0
-   if (up_data.O8.Output_8_bits.status & UP_STATUS_OK)
+#if ENABLE_ACQUISITION_THREAD
+   /* Hand over to acquisition thread */
+   app_image_pack (
+      &app_image,
+      &app_image.outputs,
+      app_triple_back (&app_outputs_tb));
+   app_triple_publish (&app_outputs_tb);
+   os_event_set (acq_event, ACQ_EVENT_OUTPUTS_RECEIVED);
+#else
+   write_actuators (&up_data);
+#endif
+
+#if ENABLE_PROCESS_IMAGE
+   uint8_t * bank = pimage_write_begin (app_pimage, PIMAGE_OUTPUTS, false);
+   app_image_pack (&app_image, &app_image.outputs, bank);
+   pimage_write_end (app_pimage, PIMAGE_OUTPUTS);
+#endif
+}
+
+/**
+ * Write transport statistics to /tmp/u-phy-transport.txt. Only done
+ * on request, to keep file operations off the cyclic path.
+ */
+static void write_transport_file (void)
+{
+#if ENABLE_IO_FILES
+   FILE * f = fopen ("/tmp/u-phy-transport.txt", "w");
+
+   if (f != NULL)
    {
-      set_actuator (up_data.O8.Output_8_bits.value);
+      fprintf (f, "{\"transport\": ");
+      app_transport_write_json (&app_transport, f);
+      fprintf (f, ", \"reconnects\": %" PRIu32 "}\n", app_session.reconnects);
+      fclose (f);
    }
 #endif
+}
+
+static void show_transport_stats (void)
+{
+   app_transport_show (&app_transport);
+   printf ("Reconnects: %" PRIu32 "\n", app_session.reconnects);
+   write_transport_file();
+}
+
+static void update_status (void * user_arg)
+{
+   /* Use this function to publish device state */
+   if (!status_dirty)
+   {
+      app_stats.status_updates_skipped++;
+   }
+   else
+   {
+      status_dirty = false;
+#if ENABLE_IO_FILES && !ENABLE_PROCESS_IMAGE
+      up_util_write_status_file ("/tmp/u-phy-status.txt");
+#endif
+   }
 
 #if ENABLE_IO_FILES
-   up_util_write_status_file ("/tmp/u-phy-status.txt");
-   up_util_poll_cmd_file ("/tmp/u-phy-command.txt");
+   poll_commands();
+#endif
+}
+
+/**
+ * Check if any input changed since the inputs were last sent. Also
+ * schedules the periodic refresh of all signals.
+ *
+ * @return true if inputs should be sent
+ */
+static bool inputs_changed (void)
+{
+#if ENABLE_CHANGE_TRACKING
+   uint32_t n_bytes = app_inputs_dirty.n_bytes;
+   uint16_t n_changed;
+   bool keyframe;
+#endif
+
+   app_stats.cycles++;
+
+#if ENABLE_CHANGE_TRACKING
+   if (app_stats.cycles % CHANGE_TRACKING_REFRESH_CYCLES == 0)
+   {
+      app_dirty_invalidate (&app_inputs_dirty);
+      app_dirty_invalidate (&app_outputs_dirty);
+   }
+
+   keyframe = app_inputs_dirty.invalid;
+   n_changed = app_dirty_scan (&app_inputs_dirty);
+   if (n_changed == 0)
+   {
+      app_stats.input_writes_skipped++;
+      return false;
+   }
+
+   app_stats.input_bytes += app_image.inputs.size;
+   app_stats.input_delta_bytes +=
+      keyframe ? app_image.inputs.size
+               : (app_inputs_dirty.n_bytes - n_bytes) +
+                    n_changed * DELTA_RECORD_OVERHEAD;
+#endif
+
+   status_dirty = true;
+   return true;
+}
+
+/**
+ * Check if any output changed since the outputs were last activated.
+ *
+ * @return true if outputs should be activated
+ */
+static bool outputs_changed (void)
+{
+#if ENABLE_CHANGE_TRACKING
+   if (app_dirty_scan (&app_outputs_dirty) == 0)
+   {
+      app_stats.output_updates_skipped++;
+      return false;
+   }
 #endif
+
+   status_dirty = true;
+   return true;
 }
 
 static void cb_avail (up_t * up, void * user_arg)
 {
    /* Called when core has received outputs from
       controller. Synchronous mode only. */
+   app_worker.dispatched = true;
+   TIMING_BEGIN (TIMING_AVAIL);
 
    /* Receive outputs from fieldbus controller */
-   up_read_outputs (up);
+   read_outputs (up);
 
    /* Activate outputs */
-   set_outputs (user_arg);
+   if (outputs_changed())
+   {
+      set_outputs (user_arg);
+   }
+
+   update_status (user_arg);
+
+   TIMING_END (TIMING_AVAIL);
 }
 
 static void cb_sync (up_t * up, void * user_arg)
 {
    /* Called when core is about to send inputs to
       controller. Synchronous mode only. */
+   app_worker.dispatched = true;
+   TIMING_BEGIN (TIMING_SYNC);
 
    /* Latch inputs */
    get_inputs (user_arg);
 
    /* Send inputs to fieldbus controller */
-   up_write_inputs (up);
+   if (inputs_changed())
+   {
+      write_inputs (up);
+   }
+
+   RECORD_CYCLE();
+
+   TIMING_END (TIMING_SYNC);
 }
 
-static void cb_param_write_ind (up_t * up, void * user_arg)
+/**
+ * Record retrieved parameter write requests in flight recorder.
+ */
+static void record_params (void)
+{
+#if ENABLE_FLIGHT_RECORDER
+   const app_param_write_t * req;
+   uint16_t i;
+
+   for (i = 0; i < app_param_batch.n_reqs; i++)
+   {
+      req = &app_param_batch.reqs[i];
+      RECORD_EVENT (
+         APP_RECORD_PARAM,
+         (uint32_t)req->slot_ix << 16 | req->param_ix,
+         req->value,
+         req->length);
+   }
+#endif
+}
+
+/**
+ * Stage retrieved writes to persistent parameters in the journal.
+ */
+static void journal_params (void)
 {
-   uint16_t slot_ix;
-   uint16_t param_ix;
-   binary_t data;
-   up_param_t * p;
+#if ENABLE_PARAM_JOURNAL
+   const app_param_write_t * req;
+   uint16_t i;
+
+   for (i = 0; i < app_param_batch.n_reqs; i++)
+   {
+      req = &app_param_batch.reqs[i];
+      app_journal_write (
+         &app_journal,
+         req->slot_ix,
+         req->param_ix,
+         req->value,
+         req->length);
+   }
+#endif
+}
 
+static void cb_param_write_ind (up_t * up, void * user_arg)
+{
    /* Called when controller requests write to a parameter */
+   app_worker.dispatched = true;
+   TIMING_BEGIN (TIMING_PARAM_WRITE);
 
-   while (up_param_get_write_req (up, &slot_ix, &param_ix, &data) == 0)
+   /* Each retrieval is recorded in the transport statistics */
+   while (app_param_batch_get (&app_param_batch, up) > 0)
    {
-      p = &up_device.slots[slot_ix].params[param_ix];
-      memcpy (up_vars[p->ix].value, data.data, data.dataLength);
-      free (data.data);
+      record_params();
+      journal_params();
+      app_param_batch_apply (&app_param_batch, up_vars);
+      app_stats.param_batches++;
    }
+
+   TIMING_END (TIMING_PARAM_WRITE);
 }
 
 static void cb_status_ind (up_t * up, uint32_t status, void * user_arg)
 {
    /* Called when device status changes */
+   app_worker.dispatched = true;
+   status_dirty = true;
+#if ENABLE_FLIGHT_RECORDER
+   app_device_status = status;
+#endif
+   RECORD_EVENT (APP_RECORD_STATUS, status, NULL, 0);
 }
 
 static void cb_error_ind (up_t * up, up_error_t error_code, void * user_arg)
@@ -125,6 +763,11 @@ static void cb_error_ind (up_t * up, up_error_t error_code, void * user_arg)
       "ERROR: error_code=%" PRIi16 " %s\n",
       error_code,
       up_error_to_str (error_code));
+
+   RECORD_EVENT (APP_RECORD_ERROR, (uint32_t)error_code, NULL, 0);
+#if ENABLE_FLIGHT_RECORDER
+   recorder_dump_requested = 1;
+#endif
 }
 
 static void cb_profinet_signal_led_ind (up_t * up, void * user_arg)
@@ -133,20 +776,71 @@ static void cb_profinet_signal_led_ind (up_t * up, void * user_arg)
    printf ("Flash Profinet signal LED for 3s at 1Hz\n");
 }
 
+/**
+ * Write flight recorder history to APP_RECORDER_FILE.
+ */
+static void dump_recorder (void)
+{
+#if ENABLE_FLIGHT_RECORDER
+   int n = app_recorder_dump (&app_recorder, APP_RECORDER_FILE);
+
+   if (n < 0)
+   {
+      printf ("Failed to write " APP_RECORDER_FILE "\n");
+      return;
+   }
+   printf ("Wrote %d records to " APP_RECORDER_FILE "\n", n);
+#else
+   printf ("Flight recorder not enabled\n");
+#endif
+}
+
 static void cb_loop_ind (up_t * up, void * user_arg)
 {
    /* Called every 10 ms. Used to implement free-running (i.e. not
       synchronous) mode.  */
+   app_worker.dispatched = true;
+   TIMING_BEGIN (TIMING_LOOP);
 
 #if !(APPLICATION_MODE_SYNCHRONOUS)
    /* Read and activate outputs */
-   up_read_outputs (up);
-   set_outputs (user_arg);
+   read_outputs (up);
+   if (outputs_changed())
+   {
+      set_outputs (user_arg);
+   }
 
    /* Latch and write inputs */
    get_inputs (user_arg);
-   up_write_inputs (up);
+   if (inputs_changed())
+   {
+      write_inputs (up);
+   }
+
+   update_status (user_arg);
+   RECORD_CYCLE();
 #endif
+
+   TIMING_END (TIMING_LOOP);
+
+   if (stats_requested)
+   {
+      stats_requested = 0;
+      app_show_stats();
+      write_transport_file();
+   }
+
+   if (transport_stats_requested)
+   {
+      transport_stats_requested = 0;
+      show_transport_stats();
+   }
+
+   if (recorder_dump_requested)
+   {
+      recorder_dump_requested = 0;
+      dump_recorder();
+   }
 }
 
 /**
@@ -154,7 +848,7 @@ static void cb_loop_ind (up_t * up, void * user_arg)
  * - Generate template input file and initialize up data
  *  - Generate default status file
  */
-#if ENABLE_IO_FILES
+#if ENABLE_IO_FILES && !ENABLE_PROCESS_IMAGE
 static void init_util_files (void)
 {
    up_util_write_input_file ("/tmp/u-phy-input.txt");
@@ -163,6 +857,72 @@ static void init_util_files (void)
 }
 #endif
 
+/**
+ * Initialize shared-memory process image.
+ * - Export signal descriptors for inputs and outputs
+ * - Publish initial input values and status
+ */
+#if ENABLE_PROCESS_IMAGE
+static void add_signals (
+   pimage_signal_t * signals,
+   const app_image_section_t * section,
+   pimage_dir_t dir)
+{
+   uint16_t i;
+
+   for (i = 0; i < section->n_signals; i++)
+   {
+      const app_image_signal_t * s = &section->signals[i];
+
+      snprintf (signals[i].name, sizeof (signals[i].name), "%s.%s", s->slot, s->name);
+      signals[i].offset = s->offset;
+      signals[i].status_offset = section->status_offset + i;
+      signals[i].size = s->size;
+      signals[i].dir = dir;
+   }
+}
+
+static void init_process_image (void)
+{
+   pimage_signal_t * signals;
+   uint32_t n_signals;
+
+   n_signals = app_image.inputs.n_signals + app_image.outputs.n_signals;
+   signals = calloc (n_signals, sizeof (pimage_signal_t));
+   if (signals == NULL && n_signals > 0)
+   {
+      printf ("Failed to init process image\n");
+      exit (EXIT_FAILURE);
+   }
+
+   add_signals (signals, &app_image.inputs, PIMAGE_INPUTS);
+   add_signals (
+      signals + app_image.inputs.n_signals,
+      &app_image.outputs,
+      PIMAGE_OUTPUTS);
+
+   app_pimage = pimage_create (
+      PIMAGE_DEFAULT_NAME,
+      signals,
+      n_signals,
+      app_image.inputs.size,
+      app_image.outputs.size);
+   free (signals);
+
+   if (app_pimage == NULL)
+   {
+      printf ("Failed to create process image " PIMAGE_DEFAULT_NAME "\n");
+      exit (EXIT_FAILURE);
+   }
+
+   app_image_pack (
+      &app_image,
+      &app_image.inputs,
+      pimage_write_begin (app_pimage, PIMAGE_INPUTS, false));
+   pimage_write_end (app_pimage, PIMAGE_INPUTS);
+}
+#endif
+
 up_busconf_t app_busconf;
 up_cfg_t app_cfg =
 {
@@ -179,16 +939,664 @@ up_cfg_t app_cfg =
    .cb_arg = NULL,
 };
 
+/**
+ * Initialize process image layout and change tracking.
+ */
+static void init_image (void)
+{
+   if (app_image_init (&app_image, &up_device, up_vars) != 0)
+   {
+      printf ("Failed to init process image\n");
+      exit (EXIT_FAILURE);
+   }
+
+#if ENABLE_CHANGE_TRACKING
+   if (
+      app_dirty_init (&app_inputs_dirty, &app_image, &app_image.inputs) != 0 ||
+      app_dirty_init (&app_outputs_dirty, &app_image, &app_image.outputs) != 0)
+   {
+      printf ("Failed to init change tracking\n");
+      exit (EXIT_FAILURE);
+   }
+#endif
+
+   app_session.hash = app_image_hash (&up_device);
+#if SESSION_RESTORE_INPUTS
+   app_session.inputs = calloc (1, app_image.inputs.size + 1);
+   if (app_session.inputs == NULL)
+   {
+      printf ("Failed to init session snapshot\n");
+      exit (EXIT_FAILURE);
+   }
+#endif
+   printf ("Device configuration hash 0x%08" PRIx32 "\n", app_session.hash);
+}
+
+/**
+ * Initialize flight recorder.
+ */
+#if ENABLE_FLIGHT_RECORDER
+static void init_recorder (void)
+{
+   if (
+      app_recorder_init (
+         &app_recorder,
+         &app_image,
+         app_session.hash,
+         APP_RECORDER_RECORDS) != 0)
+   {
+      printf ("Failed to init flight recorder\n");
+      exit (EXIT_FAILURE);
+   }
+}
+#endif
+
+/**
+ * Initialize parameter journal and restore persistent parameters.
+ */
+#if ENABLE_PARAM_JOURNAL
+static void init_journal (void)
+{
+   if (app_param_batch.lookup == NULL)
+   {
+      printf ("Parameter journal disabled\n");
+      return;
+   }
+
+   if (
+      app_journal_init (
+         &app_journal,
+         &model_lookup,
+         up_vars,
+         app_session.hash,
+         APP_JOURNAL_FILE,
+         APP_JOURNAL_MAX_SIZE) != 0 ||
+      app_journal_start (
+         &app_journal,
+         APP_JOURNAL_THREAD_PRIORITY,
+         APP_JOURNAL_THREAD_STACK_SIZE,
+         APP_JOURNAL_FLUSH_MS) != 0)
+   {
+      printf ("Failed to init parameter journal\n");
+      exit (EXIT_FAILURE);
+   }
+
+   printf (
+      "Parameter journal: %" PRIu16 " persistent, %" PRIu32 " restored\n",
+      app_journal.n_entries,
+      app_journal.n_restored);
+}
+#endif
+
+/**
+ * Initialize acquisition thread.
+ * - Set up a private copy of the process data for the thread
+ * - Seed triple buffers with the current inputs and outputs
+ */
+#if ENABLE_ACQUISITION_THREAD
+static void acquisition_thread (void * arg)
+{
+   const uint8_t * outputs;
+   acq_header_t * header;
+   uint32_t seq = 0;
+   uint32_t value;
+   bool fresh;
+
+   for (;;)
+   {
+      outputs = app_triple_read (&app_outputs_tb, &fresh);
+      if (fresh)
+      {
+         app_image_unpack (&acq_image, &acq_image.outputs, outputs);
+         write_actuators (&acq_data);
+      }
+
+      read_sensors (&acq_data);
+      header = (acq_header_t *)app_triple_back (&app_inputs_tb);
+      header->seq = ++seq;
+      header->time = os_get_current_time_us();
+      app_image_pack (
+         &acq_image,
+         &acq_image.inputs,
+         (uint8_t *)header + sizeof (acq_header_t));
+      app_triple_publish (&app_inputs_tb);
+
+      /* Wait until the snapshot is taken or new outputs arrive, but
+         sample at least every ACQUISITION_PERIOD_US */
+      os_event_wait (
+         acq_event,
+         ACQ_EVENT_INPUTS_TAKEN | ACQ_EVENT_OUTPUTS_RECEIVED,
+         &value,
+         (ACQUISITION_PERIOD_US + 999) / 1000);
+      os_event_clr (acq_event, value);
+   }
+}
+
+static void init_acquisition (void)
+{
+   uint16_t n_vars = app_image_n_vars (&up_device);
+   up_signal_info_t * vars;
+   acq_header_t * header;
+   uint8_t * outputs;
+   uint8_t * buf;
+
+   vars = calloc ((n_vars > 0) ? n_vars : 1, sizeof (up_signal_info_t));
+   buf = calloc (
+      1,
+      sizeof (acq_header_t) + app_image.inputs.size + app_image.outputs.size);
+   acq_event = os_event_create();
+   if (
+      vars == NULL || buf == NULL || acq_event == NULL ||
+      app_triple_init (
+         &app_inputs_tb,
+         sizeof (acq_header_t) + app_image.inputs.size) != 0 ||
+      app_triple_init (&app_outputs_tb, app_image.outputs.size) != 0)
+   {
+      printf ("Failed to init acquisition thread\n");
+      exit (EXIT_FAILURE);
+   }
+
+   memcpy (&acq_data, &up_data, sizeof (acq_data));
+   app_image_relocate (
+      up_vars,
+      vars,
+      n_vars,
+      &up_data,
+      &acq_data,
+      sizeof (up_data));
+   acq_image = app_image;
+   acq_image.vars = vars;
+
+   header = (acq_header_t *)buf;
+   header->time = os_get_current_time_us();
+   outputs = buf + sizeof (acq_header_t) + app_image.inputs.size;
+   app_image_pack (
+      &app_image,
+      &app_image.inputs,
+      buf + sizeof (acq_header_t));
+   app_triple_fill (&app_inputs_tb, buf);
+   app_image_pack (&app_image, &app_image.outputs, outputs);
+   app_triple_fill (&app_outputs_tb, outputs);
+   free (buf);
+   app_histogram_reset (&acq_stats.age);
+
+   if (
+      os_thread_create (
+         "acquisition",
+         ACQUISITION_THREAD_PRIORITY,
+         ACQUISITION_THREAD_STACK_SIZE,
+         acquisition_thread,
+         NULL) == NULL)
+   {
+      printf ("Failed to start acquisition thread\n");
+      exit (EXIT_FAILURE);
+   }
+}
+#endif
+
+/**
+ * Initialize parameter write batch.
+ */
+static void init_param_batch (void)
+{
+   if (
+      app_param_batch_init (
+         &app_param_batch,
+         &up_device,
+         app_param_reqs,
+         APP_PARAM_BATCH_SIZE) != 0)
+   {
+      printf ("Failed to init parameter batch\n");
+      exit (EXIT_FAILURE);
+   }
+
+   app_param_batch_set_transport (&app_param_batch, &app_transport);
+
+#if ENABLE_MODEL_LOOKUP
+   if (app_lookup_check (&model_lookup, &up_device) == 0)
+   {
+      app_param_batch_set_lookup (
+         &app_param_batch,
+         &model_lookup,
+         ENABLE_PARAM_RANGE_CHECK);
+   }
+   else
+   {
+      printf ("Lookup tables do not match device model, not used\n");
+   }
+#endif
+}
+
+/**
+ * Initialize callback timing instrumentation.
+ */
+#if ENABLE_CYCLE_TIMING
+static void init_timing (void)
+{
+   app_timing_init (&app_timing[TIMING_SYNC], "sync", APP_CYCLE_BUDGET_US);
+   app_timing_init (&app_timing[TIMING_AVAIL], "avail", APP_CYCLE_BUDGET_US);
+   app_timing_init (&app_timing[TIMING_LOOP], "loop", APP_CYCLE_BUDGET_US);
+   app_timing_init (&app_timing[TIMING_PARAM_WRITE], "param_write", 0);
+}
+#endif
+
+/**
+ * Run up_worker() until it fails, blocking between calls if
+ * configured.
+ */
+static void run_worker (up_t * up)
+{
+   uint32_t value;
+   uint32_t t0;
+   uint32_t elapsed;
+   uint32_t oversleep;
+   bool timeout;
+
+   app_worker.start = os_get_current_time_us();
+
+   while (up_worker (up) == true)
+   {
+      app_worker.calls++;
+      if (app_worker.idle_ms == 0)
+      {
+         continue;
+      }
+
+      /* More work may be pending after a callback, so only block
+         after a call that found nothing to do */
+      if (app_worker.dispatched)
+      {
+         app_worker.dispatched = false;
+         app_worker.busy++;
+         continue;
+      }
+
+      t0 = os_get_current_time_us();
+      timeout = os_event_wait (
+         app_worker.event,
+         WORKER_EVENT_WAKE,
+         &value,
+         app_worker.idle_ms);
+      elapsed = os_get_current_time_us() - t0;
+      app_worker.idle_us += elapsed;
+
+      if (timeout)
+      {
+         app_worker.timeouts++;
+         oversleep = (elapsed > app_worker.idle_ms * 1000)
+                        ? elapsed - app_worker.idle_ms * 1000
+                        : 0;
+         app_histogram_record (&app_worker.oversleep, oversleep);
+      }
+      else
+      {
+         os_event_clr (app_worker.event, WORKER_EVENT_WAKE);
+         app_worker.wakes++;
+      }
+   }
+}
+
+/**
+ * Initialize worker idle wait.
+ */
+static void init_worker (void)
+{
+   app_worker.event = os_event_create();
+   if (app_worker.event == NULL)
+   {
+      printf ("Failed to create worker event\n");
+      exit (EXIT_FAILURE);
+   }
+   app_histogram_reset (&app_worker.oversleep);
+}
+
+void app_set_worker_idle (uint32_t idle_ms)
+{
+   app_worker.idle_ms = idle_ms;
+}
+
+void app_worker_wake (void)
+{
+   /* May be called from interrupt context */
+   if (app_worker.event != NULL)
+   {
+      os_event_set (app_worker.event, WORKER_EVENT_WAKE);
+   }
+}
+
+/**
+ * Get percentage of time the worker was blocked since start.
+ */
+static uint32_t worker_idle_percent (void)
+{
+   uint32_t total = os_get_current_time_us() - app_worker.start;
+
+   if (total == 0)
+   {
+      return 0;
+   }
+
+   return (uint32_t)(app_worker.idle_us * 100 / total);
+}
+
+/**
+ * Save inputs at end of session.
+ */
+static void session_save (void)
+{
+   if (app_session.inputs != NULL)
+   {
+      app_image_pack (&app_image, &app_image.inputs, app_session.inputs);
+   }
+   app_session.saved = true;
+   app_session.lost = os_get_current_time_us();
+}
+
+/**
+ * Restore inputs of previous session, if any, and record time taken
+ * to reconnect.
+ */
+static void session_restore (void)
+{
+   uint32_t elapsed;
+
+   if (!app_session.saved)
+   {
+      return;
+   }
+
+   if (app_session.inputs != NULL)
+   {
+      app_image_unpack (&app_image, &app_image.inputs, app_session.inputs);
+   }
+
+   elapsed = os_get_current_time_us() - app_session.lost;
+   app_histogram_record (&app_session.reconnect_ms, elapsed / 1000);
+   app_session.reconnects++;
+   app_session.saved = false;
+
+   printf ("Session restored after %" PRIu32 " ms\n", elapsed / 1000);
+}
+
+void app_request_stats (void)
+{
+   stats_requested = 1;
+}
+
+void app_request_transport_stats (void)
+{
+   transport_stats_requested = 1;
+}
+
+void app_request_recorder_dump (void)
+{
+   recorder_dump_requested = 1;
+}
+
+void app_set_transport (const char * name)
+{
+   app_transport_name = name;
+}
+
+#if ENABLE_CHANGE_TRACKING
+/**
+ * Get average of a total per application cycle.
+ */
+static double per_cycle (uint64_t total)
+{
+   return (app_stats.cycles > 0) ? (double)total / app_stats.cycles : 0.0;
+}
+#endif
+
+void app_show_stats (void)
+{
+#if ENABLE_CYCLE_TIMING
+   uint32_t jitter = 0;
+   int i;
+#endif
+
+   printf ("Cycles: %" PRIu32 "\n", app_stats.cycles);
+   printf (
+      "Input writes skipped: %" PRIu32 "\n",
+      app_stats.input_writes_skipped);
+   printf (
+      "Output updates skipped: %" PRIu32 "\n",
+      app_stats.output_updates_skipped);
+   printf (
+      "Status updates skipped: %" PRIu32 "\n",
+      app_stats.status_updates_skipped);
+   printf (
+      "Parameter writes: %" PRIu32 " in %" PRIu32 " batches, %" PRIu32
+      " rejected (%" PRIu32 " out of range)\n",
+      app_param_batch.n_writes,
+      app_stats.param_batches,
+      app_param_batch.n_rejected,
+      app_param_batch.n_out_of_range);
+#if ENABLE_PARAM_JOURNAL
+   printf (
+      "Parameter journal: %" PRIu32 " staged, %" PRIu32 " coalesced, %" PRIu32
+      " records in %" PRIu32 " flushes, %" PRIu32 " compactions, %" PRIu32
+      " errors\n",
+      app_journal.n_staged,
+      app_journal.n_coalesced,
+      app_journal.n_records,
+      app_journal.n_flushes,
+      app_journal.n_compactions,
+      app_journal.n_errors);
+#endif
+   printf (
+      "Worker: idle %" PRIu32 " ms, %" PRIu32 " calls, %" PRIu32
+      " busy, %" PRIu32 " wakes, %" PRIu32 " timeouts, %" PRIu32
+      "%% idle\n",
+      app_worker.idle_ms,
+      app_worker.calls,
+      app_worker.busy,
+      app_worker.wakes,
+      app_worker.timeouts,
+      worker_idle_percent());
+   printf (
+      "Reconnects: %" PRIu32 ", p50=%" PRIu32 " max=%" PRIu32 " ms\n",
+      app_session.reconnects,
+      app_histogram_percentile (&app_session.reconnect_ms, 500),
+      app_session.reconnect_ms.max);
+   app_transport_show (&app_transport);
+#if ENABLE_CHANGE_TRACKING
+   printf (
+      "Input changes: %" PRIu32 " (%" PRIu32 " bytes)\n",
+      app_inputs_dirty.n_changes,
+      app_inputs_dirty.n_bytes);
+   printf (
+      "Output changes: %" PRIu32 " (%" PRIu32 " bytes)\n",
+      app_outputs_dirty.n_changes,
+      app_outputs_dirty.n_bytes);
+   printf (
+      "Input bytes per cycle: %.3f full, %.3f delta encoded\n",
+      per_cycle (app_stats.input_bytes),
+      per_cycle (app_stats.input_delta_bytes));
+#endif
+#if ENABLE_ACQUISITION_THREAD
+   printf (
+      "Input snapshots: %" PRIu32 " reused, %" PRIu32 " dropped, %" PRIu32
+      " stale, age p50=%" PRIu32 " p99=%" PRIu32 " max=%" PRIu32 " us\n",
+      acq_stats.reused,
+      acq_stats.dropped,
+      acq_stats.stale,
+      app_histogram_percentile (&acq_stats.age, 500),
+      app_histogram_percentile (&acq_stats.age, 990),
+      acq_stats.age.max);
+#endif
+#if ENABLE_CYCLE_TIMING
+   for (i = 0; i < TIMING_NUM; i++)
+   {
+      app_timing_show (&app_timing[i]);
+      if (i <= TIMING_LOOP && app_timing_jitter (&app_timing[i]) > jitter)
+      {
+         jitter = app_timing_jitter (&app_timing[i]);
+      }
+   }
+   printf ("Worst-case cycle jitter: %" PRIu32 " us\n", jitter);
+#endif
+   if (app_worker.oversleep.count > 0)
+   {
+      printf (
+         "Worker oversleep: p50=%" PRIu32 " p99=%" PRIu32 " max=%" PRIu32
+         " us\n",
+         app_histogram_percentile (&app_worker.oversleep, 500),
+         app_histogram_percentile (&app_worker.oversleep, 990),
+         app_worker.oversleep.max);
+   }
+}
+
+uint32_t app_cycles (void)
+{
+   return app_stats.cycles;
+}
+
+void app_write_stats (FILE * f)
+{
+#if ENABLE_CYCLE_TIMING
+   int i;
+#endif
+
+   fprintf (
+      f,
+      "{\"cycles\": %" PRIu32 ", \"input_writes_skipped\": %" PRIu32
+      ", \"output_updates_skipped\": %" PRIu32
+      ", \"status_updates_skipped\": %" PRIu32,
+      app_stats.cycles,
+      app_stats.input_writes_skipped,
+      app_stats.output_updates_skipped,
+      app_stats.status_updates_skipped);
+   fprintf (
+      f,
+      ", \"param_writes\": %" PRIu32 ", \"param_batches\": %" PRIu32
+      ", \"param_writes_rejected\": %" PRIu32
+      ", \"param_writes_out_of_range\": %" PRIu32,
+      app_param_batch.n_writes,
+      app_stats.param_batches,
+      app_param_batch.n_rejected,
+      app_param_batch.n_out_of_range);
+#if ENABLE_PARAM_JOURNAL
+   fprintf (
+      f,
+      ", \"journal\": {\"staged\": %" PRIu32 ", \"coalesced\": %" PRIu32
+      ", \"records\": %" PRIu32 ", \"flushes\": %" PRIu32
+      ", \"compactions\": %" PRIu32 ", \"restored\": %" PRIu32
+      ", \"errors\": %" PRIu32 "}",
+      app_journal.n_staged,
+      app_journal.n_coalesced,
+      app_journal.n_records,
+      app_journal.n_flushes,
+      app_journal.n_compactions,
+      app_journal.n_restored,
+      app_journal.n_errors);
+#endif
+   fprintf (
+      f,
+      ", \"worker\": {\"idle_ms\": %" PRIu32 ", \"calls\": %" PRIu32
+      ", \"busy\": %" PRIu32 ", \"wakes\": %" PRIu32
+      ", \"timeouts\": %" PRIu32 ", \"idle_percent\": %" PRIu32,
+      app_worker.idle_ms,
+      app_worker.calls,
+      app_worker.busy,
+      app_worker.wakes,
+      app_worker.timeouts,
+      worker_idle_percent());
+   fprintf (
+      f,
+      ", \"oversleep_us\": {\"p50\": %" PRIu32 ", \"p99\": %" PRIu32
+      ", \"max\": %" PRIu32 "}}",
+      app_histogram_percentile (&app_worker.oversleep, 500),
+      app_histogram_percentile (&app_worker.oversleep, 990),
+      app_worker.oversleep.max);
+   fprintf (
+      f,
+      ", \"config_hash\": \"0x%08" PRIx32 "\", \"reconnects\": %" PRIu32
+      ", \"reconnect_ms\": {\"p50\": %" PRIu32 ", \"max\": %" PRIu32 "}",
+      app_session.hash,
+      app_session.reconnects,
+      app_histogram_percentile (&app_session.reconnect_ms, 500),
+      app_session.reconnect_ms.max);
+   fprintf (f, ", \"transport\": ");
+   app_transport_write_json (&app_transport, f);
+#if ENABLE_CHANGE_TRACKING
+   fprintf (
+      f,
+      ", \"input_changes\": %" PRIu32 ", \"input_change_bytes\": %" PRIu32
+      ", \"output_changes\": %" PRIu32 ", \"output_change_bytes\": %" PRIu32,
+      app_inputs_dirty.n_changes,
+      app_inputs_dirty.n_bytes,
+      app_outputs_dirty.n_changes,
+      app_outputs_dirty.n_bytes);
+   fprintf (
+      f,
+      ", \"input_bytes_per_cycle\": %.3f"
+      ", \"input_delta_bytes_per_cycle\": %.3f",
+      per_cycle (app_stats.input_bytes),
+      per_cycle (app_stats.input_delta_bytes));
+#endif
+#if ENABLE_ACQUISITION_THREAD
+   fprintf (
+      f,
+      ", \"input_snapshots\": {\"reused\": %" PRIu32
+      ", \"dropped\": %" PRIu32 ", \"stale\": %" PRIu32
+      ", \"age_us\": {\"p50\": %" PRIu32 ", \"p99\": %" PRIu32
+      ", \"max\": %" PRIu32 "}}",
+      acq_stats.reused,
+      acq_stats.dropped,
+      acq_stats.stale,
+      app_histogram_percentile (&acq_stats.age, 500),
+      app_histogram_percentile (&acq_stats.age, 990),
+      acq_stats.age.max);
+#endif
+#if ENABLE_CYCLE_TIMING
+   fprintf (f, ", \"timing\": {");
+   for (i = 0; i < TIMING_NUM; i++)
+   {
+      fprintf (f, "%s\"%s\": ", (i > 0) ? ", " : "", app_timing[i].name);
+      app_timing_write_json (&app_timing[i], f);
+   }
+   fprintf (f, "}");
+#endif
+   fprintf (f, "}");
+}
+
 void app_main (up_t * up)
 {
-#if ENABLE_IO_FILES
    static bool first_run = true;
    if (first_run)
    {
       first_run = false;
+#if ENABLE_CYCLE_TIMING
+      init_timing();
+#endif
+      init_worker();
+      init_param_batch();
+      app_histogram_reset (&app_session.reconnect_ms);
+      app_transport_init (&app_transport, app_transport_name);
+      init_image();
+#if ENABLE_FLIGHT_RECORDER
+      init_recorder();
+#endif
+#if ENABLE_PARAM_JOURNAL
+      init_journal();
+#endif
+#if ENABLE_PROCESS_IMAGE
+      init_process_image();
+#elif ENABLE_IO_FILES
       init_util_files();
-   }
 #endif
+#if ENABLE_ACQUISITION_THREAD
+      init_acquisition();
+#endif
+#if ENABLE_IO_FILES
+      app_cmd_listener = cmd_listener_start ("/tmp/u-phy-command.txt");
+      if (app_cmd_listener == NULL)
+      {
+         printf ("Failed to start command listener, polling instead\n");
+      }
+#endif
+   }
 
    if (up_start_device (up) != 0)
    {
@@ -212,10 +1620,27 @@ void app_main (up_t * up)
    }
 #endif
 
-   /* Latch and write input signals to set initial values and status */
+   /* Latch and write input signals to set initial values and
+      status. Inputs not set by read_sensors() keep their values from
+      the previous session. */
+   session_restore();
    get_inputs (app_cfg.cb_arg);
-   up_write_inputs (up);
+#if ENABLE_CHANGE_TRACKING
+   app_dirty_invalidate (&app_inputs_dirty);
+   app_dirty_invalidate (&app_outputs_dirty);
+   app_dirty_scan (&app_inputs_dirty);
+#endif
+   write_inputs (up);
+   status_dirty = true;
 
-   while (up_worker (up) == true)
-      ;
+   run_worker (up);
+
+   /* Connection to core lost */
+   session_save();
+#if ENABLE_PARAM_JOURNAL
+   app_journal_request_flush (&app_journal);
+#endif
+#if ENABLE_FLIGHT_RECORDER
+   dump_recorder();
+#endif
 }
@@ -12,6 +12,8 @@
 
 #include "up_api.h"
 
+#include <stdio.h>
+
 extern up_busconf_t app_busconf; /**< Active fieldbus configuration */
 extern up_cfg_t app_cfg;         /**< Application device configuration */
 
@@ -21,3 +23,69 @@ extern up_cfg_t app_cfg;         /**< Application device configuration */
  * @param up            u-phy state
  */
 void app_main (up_t * up);
+
+/**
+ * Print application statistics. Interactive ports register this with
+ * atexit(); ports writing a machine-readable report to stdout do not.
+ */
+void app_show_stats (void);
+
+/**
+ * Request application statistics to be printed from the application
+ * thread. With I/O files, transport statistics are also written to
+ * /tmp/u-phy-transport.txt. Safe to call from a signal handler or
+ * another thread.
+ */
+void app_request_stats (void);
+
+/**
+ * Request transport statistics to be printed from the application
+ * thread. With I/O files, they are also written to
+ * /tmp/u-phy-transport.txt. Safe to call from a signal handler or
+ * another thread.
+ */
+void app_request_transport_stats (void);
+
+/**
+ * Request the flight recorder history to be written to file from the
+ * application thread. Safe to call from a signal handler or another
+ * thread.
+ */
+void app_request_recorder_dump (void);
+
+/**
+ * Set name of the transport to the core, used when reporting
+ * transport statistics. Call before app_main().
+ *
+ * @param name          transport, e.g. "tcp:eth0"
+ */
+void app_set_transport (const char * name);
+
+/**
+ * Set time to block after an up_worker() call that dispatched no
+ * callback.
+ *
+ * @param idle_ms       maximum idle time in ms, 0 to busy poll
+ */
+void app_set_worker_idle (uint32_t idle_ms);
+
+/**
+ * Wake the application thread if it is blocked between up_worker()
+ * calls. Call when the core signals an event. Safe to call from an
+ * interrupt handler.
+ */
+void app_worker_wake (void);
+
+/**
+ * Get number of application cycles since start
+ *
+ * @return number of cycles
+ */
+uint32_t app_cycles (void);
+
+/**
+ * Write application statistics as a JSON object
+ *
+ * @param f             output stream
+ */
+void app_write_stats (FILE * f);
@@ -13,20 +13,173 @@
 enable_language(ASM)
 
 option(ENABLE_IO_FILES "" ON)
+option(ENABLE_PROCESS_IMAGE "Exchange signals through shared memory" OFF)
+option(ENABLE_ACQUISITION_THREAD "Read sensors in a separate thread" OFF)
+option(ENABLE_FLIGHT_RECORDER "Record process data and events in memory" OFF)
+set(RECORDER_FILE "/tmp/u-phy-recorder.bin" CACHE STRING
+  "File written when the flight recorder is dumped")
+option(ENABLE_PARAM_RANGE_CHECK "Drop parameter writes out of model range" OFF)
+option(ENABLE_PARAM_JOURNAL "Journal persistent parameters to file" OFF)
+set(JOURNAL_FILE "/tmp/u-phy-params" CACHE STRING
+  "Base path of the persistent parameter journal files")
+set(EEPROM_MARKER "" CACHE STRING
+  "File recording the last EtherCAT eeprom written, empty to always write")
 
-target_sources(sample
+# Shared-memory process image library, for use by the application
+# and by external processes
+add_library(pimage STATIC
+  ports/linux/pimage.c
+)
+
+target_include_directories(pimage
+  PUBLIC
+  ${CMAKE_CURRENT_SOURCE_DIR}/ports/linux
+)
+
+target_link_libraries(pimage
+  PUBLIC
+  rt
+)
+
+add_executable(pimage-bench
+  ports/linux/pimage_bench.c
+)
+
+target_link_libraries(pimage-bench
+  PRIVATE
+  pimage
+)
+
+find_package(Threads REQUIRED)
+
+target_sources(sample-app
   PRIVATE
   eeprom.S
-  $<$<BOOL:${OPTION_MONO}>:ports/linux/mono.c>
-  $<$<NOT:$<BOOL:${OPTION_MONO}>>:ports/linux/client.c>
+  app_eeprom.c
+  ports/linux/rt.c
+  $<$<BOOL:${ENABLE_IO_FILES}>:ports/linux/cmd_listener.c>
+  $<$<BOOL:${ENABLE_ACQUISITION_THREAD}>:app_triple.c>
+  $<$<BOOL:${ENABLE_FLIGHT_RECORDER}>:app_recorder.c>
+  $<$<BOOL:${ENABLE_PARAM_JOURNAL}>:app_journal.c>
 )
 
-target_compile_definitions(sample
+target_include_directories(sample-app
+  PUBLIC
+  ${CMAKE_CURRENT_SOURCE_DIR}/ports/linux
+)
+
+target_compile_definitions(sample-app
   PRIVATE
   $<$<BOOL:${ENABLE_IO_FILES}>:ENABLE_IO_FILES=1>
+  $<$<BOOL:${ENABLE_PROCESS_IMAGE}>:ENABLE_PROCESS_IMAGE=1>
+  $<$<BOOL:${ENABLE_ACQUISITION_THREAD}>:ENABLE_ACQUISITION_THREAD=1>
+  $<$<BOOL:${ENABLE_FLIGHT_RECORDER}>:ENABLE_FLIGHT_RECORDER=1>
+  $<$<BOOL:${ENABLE_FLIGHT_RECORDER}>:APP_RECORDER_FILE="${RECORDER_FILE}">
+  $<$<BOOL:${ENABLE_PARAM_RANGE_CHECK}>:ENABLE_PARAM_RANGE_CHECK=1>
+  $<$<BOOL:${ENABLE_PARAM_JOURNAL}>:ENABLE_PARAM_JOURNAL=1>
+  $<$<BOOL:${ENABLE_PARAM_JOURNAL}>:APP_JOURNAL_FILE="${JOURNAL_FILE}">
+  $<$<BOOL:${EEPROM_MARKER}>:APP_EEPROM_MARKER="${EEPROM_MARKER}">
+)
+
+target_link_libraries(sample-app
+  PUBLIC
+  Threads::Threads
+  $<$<BOOL:${ENABLE_PROCESS_IMAGE}>:pimage>
 )
 
-target_compile_options(sample
+target_compile_options(sample-app
   PRIVATE
   $<$<STREQUAL:${CMAKE_SYSTEM_NAME},Linux>:-Wa,--noexecstack>
 )
+
+target_sources(sample
+  PRIVATE
+  $<$<BOOL:${OPTION_MONO}>:ports/linux/mono.c>
+  $<$<NOT:$<BOOL:${OPTION_MONO}>>:ports/linux/client.c>
+)
+
+# Benchmark of the application running on the mock fieldbus
+add_executable(sample-bench
+  ports/linux/bench.c
+)
+
+get_filename_component(bench_model ${SAMPLE_MODEL} NAME)
+
+target_compile_definitions(sample-bench
+  PRIVATE
+  BENCH_MODEL="${bench_model}"
+  $<$<BOOL:${OPTION_MONO}>:BENCH_MONO=1>
+)
+
+target_link_libraries(sample-bench
+  PRIVATE
+  sample-app
+)
+
+# Run cycles back to back, count heap allocations made by statically
+# linked code, and transport traffic in the client build
+target_link_options(sample-bench
+  PRIVATE
+  -Wl,--wrap=up_worker,--wrap=up_write_event_mask
+  -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free
+  $<$<NOT:$<BOOL:${OPTION_MONO}>>:-Wl,--wrap=send,--wrap=recv,--wrap=read,--wrap=write,--wrap=close>
+)
+
+# Per-variable versus block copies of the packed process image
+if (Python3_Interpreter_FOUND)
+  add_executable(sample-image-bench
+    ports/linux/image_bench.c
+  )
+
+  target_link_libraries(sample-image-bench
+    PRIVATE
+    sample-app
+  )
+endif()
+
+# Per-signal versus bulk status and bit array operations
+add_executable(sample-bulk-bench
+  ports/linux/bulk_bench.c
+)
+
+target_link_libraries(sample-bulk-bench
+  PRIVATE
+  sample-app
+)
+
+# Application load test against an emulated controller, replacing
+# the cyclic u-phy API at link time
+add_executable(sample-emu
+  ports/linux/emu.c
+)
+
+target_link_libraries(sample-emu
+  PRIVATE
+  sample-app
+)
+
+# Generate parameter values within the model range
+target_compile_definitions(sample-emu
+  PRIVATE
+  $<$<BOOL:${ENABLE_MODEL_LOOKUP}>:ENABLE_MODEL_LOOKUP=1>
+)
+
+target_link_options(sample-emu
+  PRIVATE
+  -Wl,--wrap=up_start_device,--wrap=up_write_event_mask
+  -Wl,--wrap=up_enable_watchdog,--wrap=up_worker
+  -Wl,--wrap=up_read_outputs,--wrap=up_write_inputs
+  -Wl,--wrap=up_param_get_write_req
+)
+
+# Host process driving several cores, client build only
+if (NOT OPTION_MONO)
+  add_executable(sample-multi
+    ports/linux/multi.c
+  )
+
+  target_link_libraries(sample-multi
+    PRIVATE
+    sample-app
+  )
+endif()
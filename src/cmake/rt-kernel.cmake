@@ -12,9 +12,40 @@
 
 enable_language(ASM)
 
-target_sources(sample
+option(ENABLE_ACQUISITION_THREAD "Read sensors in a separate thread" OFF)
+option(ENABLE_FLIGHT_RECORDER "Record process data and events in memory" OFF)
+set(RECORDER_FILE "/disk1/recorder.bin" CACHE STRING
+  "File written when the flight recorder is dumped")
+option(ENABLE_PARAM_RANGE_CHECK "Drop parameter writes out of model range" OFF)
+option(ENABLE_PARAM_JOURNAL "Journal persistent parameters to file" OFF)
+set(JOURNAL_FILE "/disk1/params" CACHE STRING
+  "Base path of the persistent parameter journal files")
+set(EEPROM_MARKER "" CACHE STRING
+  "File recording the last EtherCAT eeprom written, empty to always write")
+
+target_sources(sample-app
   PRIVATE
   eeprom.S
+  app_eeprom.c
+  $<$<BOOL:${ENABLE_ACQUISITION_THREAD}>:app_triple.c>
+  $<$<BOOL:${ENABLE_FLIGHT_RECORDER}>:app_recorder.c>
+  $<$<BOOL:${ENABLE_PARAM_JOURNAL}>:app_journal.c>
+)
+
+target_compile_definitions(sample-app
+  PRIVATE
+  $<$<BOOL:${ENABLE_ACQUISITION_THREAD}>:ENABLE_ACQUISITION_THREAD=1>
+  $<$<BOOL:${ENABLE_FLIGHT_RECORDER}>:ENABLE_FLIGHT_RECORDER=1>
+  $<$<BOOL:${ENABLE_FLIGHT_RECORDER}>:APP_RECORDER_FILE="${RECORDER_FILE}">
+  $<$<BOOL:${ENABLE_PARAM_RANGE_CHECK}>:ENABLE_PARAM_RANGE_CHECK=1>
+  $<$<BOOL:${ENABLE_PARAM_JOURNAL}>:ENABLE_PARAM_JOURNAL=1>
+  $<$<BOOL:${ENABLE_PARAM_JOURNAL}>:APP_JOURNAL_FILE="${JOURNAL_FILE}">
+  $<$<BOOL:${EEPROM_MARKER}>:APP_EEPROM_MARKER="${EEPROM_MARKER}">
+)
+
+target_sources(sample
+  PRIVATE
+  ports/rt-kernel/shell_cmds.c
   $<$<BOOL:${OPTION_MONO}>:ports/rt-kernel/mono.c>
   $<$<NOT:$<BOOL:${OPTION_MONO}>>:ports/rt-kernel/client.c>
 )
@@ -0,0 +1,580 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Benchmark of the sample application running on the mock fieldbus.
+ *
+ * The mock fieldbus only indicates a cycle every 10 ms. To measure the
+ * cost of a cycle rather than the bus period, up_worker() is replaced
+ * at link time (--wrap) so that each call, after the core has handled
+ * pending events, runs one application cycle back to back: the loop
+ * indication in free-running mode, or the avail and sync indications
+ * in synchronous mode. The reads and writes of process data still go
+ * through the core.
+ *
+ * Runs the application for a warmup period followed by a measurement
+ * period and writes throughput, time spent in the cycle callbacks, CPU
+ * time, heap allocations and, in the client build, transport round
+ * trips and bytes per cycle together with the application statistics
+ * as JSON.
+ */
+
+#include "application.h"
+#include "options.h"
+#include "up_api.h"
+#include "up_util.h"
+#include "model.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(BENCH_MONO)
+extern void up_core_init (void);
+extern void up_core_set_status (uint32_t status);
+extern void core_set_interface (char * iface, size_t size);
+#endif
+
+typedef struct bench_sample
+{
+   uint64_t wall_ns;
+   uint64_t cpu_ns;
+   uint64_t callback_ns;
+   uint64_t driven;
+   uint64_t allocs;
+   uint64_t round_trips;
+   uint64_t tx_bytes;
+   uint64_t rx_bytes;
+   uint32_t cycles;
+} bench_sample_t;
+
+static struct
+{
+   unsigned int warmup;
+   unsigned int duration;
+   const char * output;
+   const char * transport;
+   uint64_t init_device_ns; /**< Duration of last up_init_device() */
+   uint64_t util_init_ns;   /**< Duration of last up_util_init() */
+} bench_cfg = {
+   .warmup = 2,
+   .duration = 10,
+   .output = NULL,
+};
+
+static atomic_uint_fast64_t bench_allocs;
+
+/* Cycles run by the wrapped up_worker() and time spent in their
+   callbacks */
+static atomic_uint_fast64_t bench_driven;
+static atomic_uint_fast64_t bench_callback_ns;
+static atomic_bool bench_sync;
+
+/* Heap allocations are counted by wrapping the allocator at link
+   time. Only statically linked code is counted. */
+void * __real_malloc (size_t size);
+void * __real_calloc (size_t n, size_t size);
+void * __real_realloc (void * ptr, size_t size);
+void __real_free (void * ptr);
+
+void * __wrap_malloc (size_t size)
+{
+   atomic_fetch_add_explicit (&bench_allocs, 1, memory_order_relaxed);
+   return __real_malloc (size);
+}
+
+void * __wrap_calloc (size_t n, size_t size)
+{
+   atomic_fetch_add_explicit (&bench_allocs, 1, memory_order_relaxed);
+   return __real_calloc (n, size);
+}
+
+void * __wrap_realloc (void * ptr, size_t size)
+{
+   atomic_fetch_add_explicit (&bench_allocs, 1, memory_order_relaxed);
+   return __real_realloc (ptr, size);
+}
+
+void __wrap_free (void * ptr)
+{
+   __real_free (ptr);
+}
+
+#if !defined(BENCH_MONO)
+/* Transport traffic is counted by wrapping the system calls used by
+   the TCP and UART transports. A round trip is counted on the first
+   receive after a send. */
+#define BENCH_MAX_FD 256
+
+typedef enum bench_fd_class
+{
+   FD_UNKNOWN = 0,
+   FD_TRANSPORT,
+   FD_OTHER,
+} bench_fd_class_t;
+
+static _Atomic uint8_t bench_fds[BENCH_MAX_FD];
+static atomic_uint_fast64_t bench_round_trips;
+static atomic_uint_fast64_t bench_tx_bytes;
+static atomic_uint_fast64_t bench_rx_bytes;
+static atomic_bool bench_sent;
+
+ssize_t __real_send (int fd, const void * buf, size_t len, int flags);
+ssize_t __real_recv (int fd, void * buf, size_t len, int flags);
+ssize_t __real_write (int fd, const void * buf, size_t len);
+ssize_t __real_read (int fd, void * buf, size_t len);
+int __real_close (int fd);
+
+static bool is_transport (int fd)
+{
+   struct stat st;
+   uint8_t cls;
+
+   /* Standard streams may be terminals but are never a transport */
+   if (fd <= STDERR_FILENO || fd >= BENCH_MAX_FD)
+   {
+      return false;
+   }
+
+   cls = atomic_load_explicit (&bench_fds[fd], memory_order_relaxed);
+   if (cls == FD_UNKNOWN)
+   {
+      cls = FD_OTHER;
+      if (
+         fstat (fd, &st) == 0 &&
+         (S_ISSOCK (st.st_mode) || (S_ISCHR (st.st_mode) && isatty (fd))))
+      {
+         cls = FD_TRANSPORT;
+      }
+      atomic_store_explicit (&bench_fds[fd], cls, memory_order_relaxed);
+   }
+
+   return cls == FD_TRANSPORT;
+}
+
+static void count_tx (int fd, ssize_t n)
+{
+   if (n > 0 && is_transport (fd))
+   {
+      atomic_fetch_add_explicit (&bench_tx_bytes, n, memory_order_relaxed);
+      atomic_store_explicit (&bench_sent, true, memory_order_relaxed);
+   }
+}
+
+static void count_rx (int fd, ssize_t n)
+{
+   if (n > 0 && is_transport (fd))
+   {
+      atomic_fetch_add_explicit (&bench_rx_bytes, n, memory_order_relaxed);
+      if (atomic_exchange_explicit (&bench_sent, false, memory_order_relaxed))
+      {
+         atomic_fetch_add_explicit (&bench_round_trips, 1, memory_order_relaxed);
+      }
+   }
+}
+
+ssize_t __wrap_send (int fd, const void * buf, size_t len, int flags)
+{
+   ssize_t n = __real_send (fd, buf, len, flags);
+   count_tx (fd, n);
+   return n;
+}
+
+ssize_t __wrap_recv (int fd, void * buf, size_t len, int flags)
+{
+   ssize_t n = __real_recv (fd, buf, len, flags);
+   count_rx (fd, n);
+   return n;
+}
+
+ssize_t __wrap_write (int fd, const void * buf, size_t len)
+{
+   ssize_t n = __real_write (fd, buf, len);
+   count_tx (fd, n);
+   return n;
+}
+
+ssize_t __wrap_read (int fd, void * buf, size_t len)
+{
+   ssize_t n = __real_read (fd, buf, len);
+   count_rx (fd, n);
+   return n;
+}
+
+int __wrap_close (int fd)
+{
+   /* The descriptor may be reused for another kind of file */
+   if (fd >= 0 && fd < BENCH_MAX_FD)
+   {
+      atomic_store_explicit (&bench_fds[fd], FD_UNKNOWN, memory_order_relaxed);
+   }
+   return __real_close (fd);
+}
+#endif
+
+static uint64_t clock_ns (clockid_t clock)
+{
+   struct timespec ts;
+   clock_gettime (clock, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/* Cyclic core API, driven back to back */
+
+bool __real_up_worker (up_t * up);
+int __real_up_write_event_mask (up_t * up, uint32_t mask);
+
+int __wrap_up_write_event_mask (up_t * up, uint32_t mask)
+{
+   atomic_store_explicit (
+      &bench_sync,
+      (mask & UP_EVENT_MASK_SYNCHRONOUS_MODE) != 0,
+      memory_order_relaxed);
+   return __real_up_write_event_mask (up, mask);
+}
+
+bool __wrap_up_worker (up_t * up)
+{
+   uint64_t t0;
+
+   if (!__real_up_worker (up))
+   {
+      return false;
+   }
+
+   t0 = clock_ns (CLOCK_MONOTONIC);
+   if (atomic_load_explicit (&bench_sync, memory_order_relaxed))
+   {
+      app_cfg.avail (up, app_cfg.cb_arg);
+      app_cfg.sync (up, app_cfg.cb_arg);
+   }
+   else
+   {
+      app_cfg.poll_ind (up, app_cfg.cb_arg);
+   }
+
+   atomic_fetch_add_explicit (
+      &bench_callback_ns,
+      clock_ns (CLOCK_MONOTONIC) - t0,
+      memory_order_relaxed);
+   atomic_fetch_add_explicit (&bench_driven, 1, memory_order_relaxed);
+   return true;
+}
+
+static void bench_take_sample (bench_sample_t * sample)
+{
+   sample->wall_ns = clock_ns (CLOCK_MONOTONIC);
+   sample->cpu_ns = clock_ns (CLOCK_PROCESS_CPUTIME_ID);
+   sample->callback_ns =
+      atomic_load_explicit (&bench_callback_ns, memory_order_relaxed);
+   sample->driven = atomic_load_explicit (&bench_driven, memory_order_relaxed);
+   sample->allocs = atomic_load_explicit (&bench_allocs, memory_order_relaxed);
+#if !defined(BENCH_MONO)
+   sample->round_trips =
+      atomic_load_explicit (&bench_round_trips, memory_order_relaxed);
+   sample->tx_bytes = atomic_load_explicit (&bench_tx_bytes, memory_order_relaxed);
+   sample->rx_bytes = atomic_load_explicit (&bench_rx_bytes, memory_order_relaxed);
+#else
+   sample->round_trips = 0;
+   sample->tx_bytes = 0;
+   sample->rx_bytes = 0;
+#endif
+   sample->cycles = app_cycles();
+}
+
+static void bench_report_model (FILE * f)
+{
+   uint32_t n_inputs = 0;
+   uint32_t n_outputs = 0;
+   uint32_t n_params = 0;
+   uint16_t ix;
+
+   for (ix = 0; ix < up_device.n_slots; ix++)
+   {
+      n_inputs += up_device.slots[ix].n_inputs;
+      n_outputs += up_device.slots[ix].n_outputs;
+      n_params += up_device.slots[ix].n_params;
+   }
+
+   fprintf (
+      f,
+      "  \"model_size\": {\"slots\": %u, \"inputs\": %" PRIu32
+      ", \"outputs\": %" PRIu32 ", \"params\": %" PRIu32 "},\n",
+      up_device.n_slots,
+      n_inputs,
+      n_outputs,
+      n_params);
+   fprintf (
+      f,
+      "  \"startup_us\": {\"init_device\": %" PRIu64
+      ", \"util_init\": %" PRIu64 "},\n",
+      bench_cfg.init_device_ns / 1000,
+      bench_cfg.util_init_ns / 1000);
+}
+
+static void bench_report (
+   FILE * f,
+   const bench_sample_t * start,
+   const bench_sample_t * end)
+{
+   uint32_t cycles = end->cycles - start->cycles;
+   uint64_t driven = end->driven - start->driven;
+   double seconds = (end->wall_ns - start->wall_ns) / 1e9;
+   double per_cycle = (cycles > 0) ? 1.0 / cycles : 0.0;
+
+   fprintf (f, "{\n");
+#if defined(BENCH_MONO)
+   fprintf (f, "  \"build\": \"mono\",\n");
+#else
+   fprintf (f, "  \"build\": \"client\",\n");
+#endif
+   fprintf (f, "  \"model\": \"%s\",\n", BENCH_MODEL);
+   fprintf (f, "  \"transport\": \"%s\",\n", bench_cfg.transport);
+   bench_report_model (f);
+   fprintf (f, "  \"duration_s\": %.3f,\n", seconds);
+   fprintf (f, "  \"cycles\": %" PRIu32 ",\n", cycles);
+   fprintf (f, "  \"cycles_per_second\": %.1f,\n", cycles / seconds);
+   fprintf (f, "  \"driven_cycles\": %" PRIu64 ",\n", driven);
+   fprintf (
+      f,
+      "  \"callback_us_per_cycle\": %.3f,\n",
+      (driven > 0) ? (end->callback_ns - start->callback_ns) / 1e3 / driven
+                   : 0.0);
+   fprintf (
+      f,
+      "  \"cpu_us_per_cycle\": %.3f,\n",
+      (end->cpu_ns - start->cpu_ns) / 1e3 * per_cycle);
+   fprintf (
+      f,
+      "  \"allocs_per_cycle\": %.3f,\n",
+      (end->allocs - start->allocs) * per_cycle);
+   fprintf (
+      f,
+      "  \"round_trips_per_cycle\": %.3f,\n",
+      (end->round_trips - start->round_trips) * per_cycle);
+   fprintf (
+      f,
+      "  \"tx_bytes_per_cycle\": %.1f,\n",
+      (end->tx_bytes - start->tx_bytes) * per_cycle);
+   fprintf (
+      f,
+      "  \"rx_bytes_per_cycle\": %.1f,\n",
+      (end->rx_bytes - start->rx_bytes) * per_cycle);
+   fprintf (f, "  \"app\": ");
+   app_write_stats (f);
+   fprintf (f, "\n}\n");
+}
+
+static void * bench_thread (void * arg)
+{
+   bench_sample_t start;
+   bench_sample_t end;
+   FILE * f = stdout;
+
+   sleep (bench_cfg.warmup);
+   bench_take_sample (&start);
+   sleep (bench_cfg.duration);
+   bench_take_sample (&end);
+
+   if (bench_cfg.output != NULL)
+   {
+      f = fopen (bench_cfg.output, "w");
+      if (f == NULL)
+      {
+         printf ("Failed to open %s\n", bench_cfg.output);
+         exit (EXIT_FAILURE);
+      }
+   }
+
+   bench_report (f, &start, &end);
+   if (f != stdout)
+   {
+      fclose (f);
+   }
+
+   /* Terminate without exit handlers, the application thread and
+      core threads are still running */
+   fflush (stdout);
+   _exit (EXIT_SUCCESS);
+}
+
+static void main_entry (up_t * up)
+{
+   uint64_t t0;
+
+   while (true)
+   {
+#if !defined(BENCH_MONO)
+      if (up_rpc_start (up, true) != 0)
+      {
+         printf ("Failed to connect to u-phy core\n");
+         exit (EXIT_FAILURE);
+      }
+#endif
+
+      t0 = clock_ns (CLOCK_MONOTONIC);
+      if (up_init_device (up) != 0)
+      {
+         printf ("Failed to configure device\n");
+         exit (EXIT_FAILURE);
+      }
+      bench_cfg.init_device_ns = clock_ns (CLOCK_MONOTONIC) - t0;
+
+      t0 = clock_ns (CLOCK_MONOTONIC);
+      if (up_util_init (&up_device, up, up_vars) != 0)
+      {
+         printf ("Failed to init up utils\n");
+         exit (EXIT_FAILURE);
+      }
+      bench_cfg.util_init_ns = clock_ns (CLOCK_MONOTONIC) - t0;
+
+      app_main (up);
+
+      printf ("Restart application\n");
+   }
+}
+
+static char transport_name[64];
+
+static int bench_start (char * transport)
+{
+   up_t * up;
+#if !defined(BENCH_MONO)
+   char * saveptr;
+   char * scheme;
+   int error = -1;
+#endif
+
+   /* Copy, as the transport is split into scheme and device below */
+   snprintf (transport_name, sizeof (transport_name), "%s", transport);
+   bench_cfg.transport = transport_name;
+#if !defined(BENCH_MONO)
+   app_set_transport (transport_name);
+#endif
+
+   app_cfg.device->bustype = UP_BUSTYPE_MOCK;
+   app_busconf.mock = up_mock_config;
+
+#if defined(BENCH_MONO)
+   up_core_init();
+   up_core_set_status (UP_CORE_CONNECTED);
+   core_set_interface (transport, strlen (transport));
+
+   up = up_init (&app_cfg);
+#else
+   up = up_init (&app_cfg);
+
+   scheme = strtok_r (transport, ":", &saveptr);
+   transport = strtok_r (NULL, ":", &saveptr);
+   if (scheme == NULL || transport == NULL)
+   {
+      return -1;
+   }
+
+#if defined(OPTION_TRANSPORT_TCP)
+   if (strcmp (scheme, "tcp") == 0)
+   {
+      error = up_tcp_transport_init (up, transport, 5150);
+   }
+#endif
+#if defined(OPTION_TRANSPORT_UART)
+   if (strcmp (scheme, "uart") == 0)
+   {
+      error = up_serial_transport_init (up, transport);
+   }
+#endif
+   if (error != 0)
+   {
+      printf ("Failed to bring up transport %s\n", scheme);
+      return -1;
+   }
+
+   if (up_rpc_init (up) != 0)
+   {
+      printf ("Failed to init rpc\n");
+      exit (EXIT_FAILURE);
+   }
+#endif
+
+   main_entry (up);
+   return 0;
+}
+
+static const char bench_help[] =
+   "Benchmark u-phy sample application on the mock fieldbus.\n"
+#if defined(BENCH_MONO)
+   "\nUsage: sample-bench [options] <network interface>\n"
+#else
+   "\nUsage: sample-bench [options] <scheme:transport>\n"
+#endif
+   "\nOptions:\n"
+   "  -w <seconds>   warmup time (default 2)\n"
+   "  -d <seconds>   measurement time (default 10)\n"
+   "  -o <file>      write JSON result to file (default stdout)\n"
+   "  -i <ms>        block up to <ms> when idle (default 0, busy\n"
+   "                 polling)\n";
+
+int main (int argc, char * argv[])
+{
+   pthread_t thread;
+   int opt;
+
+   setvbuf (stdout, NULL, _IONBF, 0);
+
+   while ((opt = getopt (argc, argv, "w:d:o:i:")) != -1)
+   {
+      switch (opt)
+      {
+      case 'w':
+         bench_cfg.warmup = strtoul (optarg, NULL, 0);
+         break;
+      case 'd':
+         bench_cfg.duration = strtoul (optarg, NULL, 0);
+         break;
+      case 'o':
+         bench_cfg.output = optarg;
+         break;
+      case 'i':
+         app_set_worker_idle (strtoul (optarg, NULL, 0));
+         break;
+      default:
+         puts (bench_help);
+         exit (EXIT_FAILURE);
+      }
+   }
+
+   if (argc - optind != 1 || bench_cfg.duration == 0)
+   {
+      puts (bench_help);
+      exit (EXIT_FAILURE);
+   }
+
+   if (pthread_create (&thread, NULL, bench_thread, NULL) != 0)
+   {
+      printf ("Failed to start benchmark thread\n");
+      exit (EXIT_FAILURE);
+   }
+
+   if (bench_start (argv[optind]) != 0)
+   {
+      puts (bench_help);
+      exit (EXIT_FAILURE);
+   }
+
+   return 0;
+}
@@ -0,0 +1,324 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Microbenchmark of bulk status and value operations.
+ *
+ * Builds a process image for a device with one slot of n UINT32
+ * inputs, laid out in memory like upgen lays out up_data, and
+ * compares per-signal loops with the app_bulk functions for marking
+ * all inputs OK, checking that all inputs are OK and converting
+ * between byte values and bit arrays. Results are written as JSON.
+ *
+ * Status operations act on the live data in up_vars. The per-signal
+ * loop is compared with app_bulk_set_var_status() (bulk_ns) and with
+ * the packed status array (packed_ns), which includes packing the
+ * section from up_vars and, when statuses are changed, unpacking it
+ * again.
+ */
+
+#include "app_bulk.h"
+#include "app_image.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Keep the compiler from optimising away writes to buf */
+#define CLOBBER(buf) __asm__ volatile ("" : : "r"(buf) : "memory")
+
+typedef struct bench_var
+{
+   uint32_t value;
+   up_signal_status_t status;
+} bench_var_t;
+
+typedef struct bench_result
+{
+   const char * name;
+   double per_signal_ns;
+   double bulk_ns;   /**< Negative if not measured */
+   double packed_ns; /**< Negative if not measured */
+} bench_result_t;
+
+static uint64_t now_ns (void)
+{
+   struct timespec ts;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static int init_image (
+   app_image_t * image,
+   up_device_t * device,
+   bench_var_t * data,
+   uint16_t n)
+{
+   static up_slot_t slot;
+   up_signal_info_t * vars;
+   up_signal_t * signals;
+   uint16_t i;
+
+   memset (device, 0, sizeof (*device));
+   vars = calloc (n, sizeof (*vars));
+   signals = calloc (n, sizeof (*signals));
+   if (vars == NULL || signals == NULL)
+   {
+      return -1;
+   }
+
+   for (i = 0; i < n; i++)
+   {
+      signals[i].name = "Input";
+      signals[i].ix = i;
+      signals[i].datatype = UP_DTYPE_UINT32;
+      signals[i].bitlength = 32;
+      vars[i].value = &data[i].value;
+      vars[i].status = &data[i].status;
+   }
+
+   slot.name = "Bench";
+   slot.n_inputs = n;
+   slot.inputs = signals;
+   device->name = "bench";
+   device->n_slots = 1;
+   device->slots = &slot;
+
+   return app_image_init (image, device, vars);
+}
+
+int main (int argc, char * argv[])
+{
+   unsigned long n_signals = 4096;
+   unsigned long n = 10000;
+   const char * output = NULL;
+   bench_result_t results[4];
+   up_device_t device;
+   app_image_t image;
+   app_image_section_t * inputs = &image.inputs;
+   bench_var_t * data;
+   uint8_t * buf;
+   uint8_t * values;
+   uint8_t * bits;
+   uint64_t t[4];
+   unsigned long i;
+   uint16_t j;
+   bool ok = true;
+   FILE * f = stdout;
+   int opt;
+
+   while ((opt = getopt (argc, argv, "s:n:o:")) != -1)
+   {
+      switch (opt)
+      {
+      case 's':
+         n_signals = strtoul (optarg, NULL, 0);
+         break;
+      case 'n':
+         n = strtoul (optarg, NULL, 0);
+         break;
+      case 'o':
+         output = optarg;
+         break;
+      default:
+         printf (
+            "Usage: %s [-s signals] [-n iterations] [-o output.json]\n",
+            argv[0]);
+         exit (EXIT_FAILURE);
+      }
+   }
+
+   if (n == 0 || n_signals == 0 || n_signals > UINT16_MAX)
+   {
+      printf ("Invalid arguments\n");
+      exit (EXIT_FAILURE);
+   }
+
+   data = calloc (n_signals, sizeof (*data));
+   values = calloc (n_signals, 1);
+   bits = calloc ((n_signals + 7) / 8, 1);
+   if (
+      data == NULL || values == NULL || bits == NULL ||
+      init_image (&image, &device, data, n_signals) != 0 ||
+      (buf = calloc (1, inputs->size)) == NULL)
+   {
+      printf ("Failed to allocate image\n");
+      exit (EXIT_FAILURE);
+   }
+
+   for (i = 0; i < n_signals; i++)
+   {
+      values[i] = (i * 7) % 3 == 0;
+   }
+
+   /* Mark all inputs OK in up_data */
+   t[0] = now_ns();
+   for (i = 0; i < n; i++)
+   {
+      for (j = 0; j < inputs->n_signals; j++)
+      {
+         *image.vars[inputs->signals[j].ix].status = UP_STATUS_OK;
+      }
+      CLOBBER (data);
+   }
+   t[1] = now_ns();
+   for (i = 0; i < n; i++)
+   {
+      app_bulk_set_var_status (
+         &image,
+         inputs,
+         0,
+         inputs->n_signals,
+         0,
+         UP_STATUS_OK);
+      CLOBBER (data);
+   }
+   t[2] = now_ns();
+   for (i = 0; i < n; i++)
+   {
+      app_image_pack (&image, inputs, buf);
+      app_bulk_set_status (inputs, buf, 0, inputs->n_signals, 0, UP_STATUS_OK);
+      app_image_unpack (&image, inputs, buf);
+      CLOBBER (data);
+   }
+   t[3] = now_ns();
+   results[0].name = "set_status";
+   results[0].per_signal_ns = (double)(t[1] - t[0]) / n;
+   results[0].bulk_ns = (double)(t[2] - t[1]) / n;
+   results[0].packed_ns = (double)(t[3] - t[2]) / n;
+
+   /* Check that all inputs are OK in up_data */
+   t[0] = now_ns();
+   for (i = 0; i < n; i++)
+   {
+      for (j = 0; j < inputs->n_signals; j++)
+      {
+         if (!(*image.vars[inputs->signals[j].ix].status & UP_STATUS_OK))
+         {
+            ok = false;
+            break;
+         }
+      }
+      CLOBBER (data);
+   }
+   t[1] = now_ns();
+   for (i = 0; i < n; i++)
+   {
+      app_image_pack (&image, inputs, buf);
+      ok &= app_bulk_status_all (
+         inputs,
+         buf,
+         0,
+         inputs->n_signals,
+         UP_STATUS_OK);
+      CLOBBER (buf);
+   }
+   t[2] = now_ns();
+   results[1].name = "status_all";
+   results[1].per_signal_ns = (double)(t[1] - t[0]) / n;
+   results[1].bulk_ns = -1;
+   results[1].packed_ns = (double)(t[2] - t[1]) / n;
+
+   /* Pack byte values into bit array */
+   t[0] = now_ns();
+   for (i = 0; i < n; i++)
+   {
+      memset (bits, 0, (n_signals + 7) / 8);
+      for (j = 0; j < n_signals; j++)
+      {
+         bits[j / 8] |= (values[j] != 0) << (j % 8);
+      }
+      CLOBBER (bits);
+   }
+   t[1] = now_ns();
+   for (i = 0; i < n; i++)
+   {
+      app_bulk_pack_bits (bits, values, n_signals);
+      CLOBBER (bits);
+   }
+   t[2] = now_ns();
+   results[2].name = "pack_bits";
+   results[2].per_signal_ns = (double)(t[1] - t[0]) / n;
+   results[2].bulk_ns = (double)(t[2] - t[1]) / n;
+   results[2].packed_ns = -1;
+
+   /* Unpack bit array into byte values */
+   t[0] = now_ns();
+   for (i = 0; i < n; i++)
+   {
+      for (j = 0; j < n_signals; j++)
+      {
+         values[j] = (bits[j / 8] >> (j % 8)) & 1;
+      }
+      CLOBBER (values);
+   }
+   t[1] = now_ns();
+   for (i = 0; i < n; i++)
+   {
+      app_bulk_unpack_bits (values, bits, n_signals);
+      CLOBBER (values);
+   }
+   t[2] = now_ns();
+   results[3].name = "unpack_bits";
+   results[3].per_signal_ns = (double)(t[1] - t[0]) / n;
+   results[3].bulk_ns = (double)(t[2] - t[1]) / n;
+   results[3].packed_ns = -1;
+
+   if (!ok)
+   {
+      printf ("Status check failed\n");
+      exit (EXIT_FAILURE);
+   }
+
+   if (output != NULL)
+   {
+      f = fopen (output, "w");
+      if (f == NULL)
+      {
+         printf ("Failed to open %s\n", output);
+         exit (EXIT_FAILURE);
+      }
+   }
+
+   fprintf (f, "{\n");
+   fprintf (f, "  \"signals\": %lu,\n", n_signals);
+   fprintf (f, "  \"iterations\": %lu,\n", n);
+   for (j = 0; j < 4; j++)
+   {
+      fprintf (
+         f,
+         "  \"%s\": {\"per_signal_ns\": %.1f",
+         results[j].name,
+         results[j].per_signal_ns);
+      if (results[j].bulk_ns >= 0)
+      {
+         fprintf (f, ", \"bulk_ns\": %.1f", results[j].bulk_ns);
+      }
+      if (results[j].packed_ns >= 0)
+      {
+         fprintf (f, ", \"packed_ns\": %.1f", results[j].packed_ns);
+      }
+      fprintf (f, "}%s\n", j < 3 ? "," : "");
+   }
+   fprintf (f, "}\n");
+
+   if (f != stdout)
+   {
+      fclose (f);
+   }
+
+   return 0;
+}
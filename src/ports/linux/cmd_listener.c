@@ -0,0 +1,164 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#define _GNU_SOURCE /* pthread_setname_np */
+
+#include "cmd_listener.h"
+
+#include <errno.h>
+#include <libgen.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#define CMD_QUEUE_SIZE 16 /* Must be power of two */
+
+struct cmd_listener
+{
+   _Atomic uint32_t head; /**< Written by listener thread */
+   _Atomic uint32_t tail; /**< Written by fieldbus thread */
+   cmd_event_t events[CMD_QUEUE_SIZE];
+   pthread_t thread;
+   int fd;
+   char name[NAME_MAX + 1];
+};
+
+static void queue_put (cmd_listener_t * listener, uint32_t mask)
+{
+   uint32_t head;
+   uint32_t tail;
+
+   head = atomic_load_explicit (&listener->head, memory_order_relaxed);
+   tail = atomic_load_explicit (&listener->tail, memory_order_acquire);
+
+   /* A full queue already makes the fieldbus thread read the command
+      file, so the event can be dropped */
+   if (head - tail >= CMD_QUEUE_SIZE)
+   {
+      return;
+   }
+
+   listener->events[head % CMD_QUEUE_SIZE].mask = mask;
+   atomic_store_explicit (&listener->head, head + 1, memory_order_release);
+}
+
+static void * listener_thread (void * arg)
+{
+   cmd_listener_t * listener = arg;
+   char buf[4096]
+      __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+   const struct inotify_event * event;
+   ssize_t len;
+   char * p;
+
+   while (true)
+   {
+      len = read (listener->fd, buf, sizeof (buf));
+      if (len < 0 && errno == EINTR)
+      {
+         continue;
+      }
+      if (len <= 0)
+      {
+         break;
+      }
+
+      for (p = buf; p < buf + len; p += sizeof (*event) + event->len)
+      {
+         event = (const struct inotify_event *)p;
+         if (event->len > 0 && strcmp (event->name, listener->name) == 0)
+         {
+            queue_put (listener, event->mask);
+         }
+      }
+   }
+
+   return NULL;
+}
+
+cmd_listener_t * cmd_listener_start (const char * path)
+{
+   cmd_listener_t * listener;
+   struct sched_param param = {0};
+   char dir[PATH_MAX];
+   char base[PATH_MAX];
+
+   listener = calloc (1, sizeof (*listener));
+   if (listener == NULL)
+   {
+      return NULL;
+   }
+
+   snprintf (dir, sizeof (dir), "%s", path);
+   snprintf (base, sizeof (base), "%s", path);
+   snprintf (listener->name, sizeof (listener->name), "%s", basename (base));
+
+   listener->fd = inotify_init1 (IN_CLOEXEC);
+   if (listener->fd < 0)
+   {
+      free (listener);
+      return NULL;
+   }
+
+   if (
+      inotify_add_watch (
+         listener->fd,
+         dirname (dir),
+         IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+   {
+      close (listener->fd);
+      free (listener);
+      return NULL;
+   }
+
+   /* Pick up any command written before the watch was added */
+   queue_put (listener, IN_CLOSE_WRITE);
+
+   if (pthread_create (&listener->thread, NULL, listener_thread, listener) != 0)
+   {
+      close (listener->fd);
+      free (listener);
+      return NULL;
+   }
+
+   /* Commands are rare and not time critical. Keep the listener
+      out of the way of the fieldbus thread. */
+   if (pthread_setschedparam (listener->thread, SCHED_BATCH, &param) != 0)
+   {
+      printf ("Failed to lower command listener priority\n");
+   }
+   pthread_setname_np (listener->thread, "up_cmd");
+
+   return listener;
+}
+
+bool cmd_listener_get (cmd_listener_t * listener, cmd_event_t * event)
+{
+   uint32_t tail = atomic_load_explicit (&listener->tail, memory_order_relaxed);
+   uint32_t head = atomic_load_explicit (&listener->head, memory_order_acquire);
+
+   if (head == tail)
+   {
+      return false;
+   }
+
+   *event = listener->events[tail % CMD_QUEUE_SIZE];
+   atomic_store_explicit (&listener->tail, tail + 1, memory_order_release);
+
+   return true;
+}
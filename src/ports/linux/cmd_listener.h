@@ -0,0 +1,55 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/**
+ * Command file listener.
+ *
+ * Watches a command file with inotify from a low-priority thread and
+ * forwards change notifications to the fieldbus thread through a
+ * single-producer, single-consumer lock-free queue. The fieldbus
+ * thread only touches the filesystem when a command has arrived.
+ */
+
+#ifndef CMD_LISTENER_H
+#define CMD_LISTENER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct cmd_event
+{
+   uint32_t mask; /**< inotify event mask */
+} cmd_event_t;
+
+typedef struct cmd_listener cmd_listener_t;
+
+/**
+ * Start listening for writes to a command file. The first call to
+ * cmd_listener_get() always returns an event, so that a command file
+ * written before start is not missed.
+ *
+ * @param path          command file path
+ * @return listener handle, or NULL on failure
+ */
+cmd_listener_t * cmd_listener_start (const char * path);
+
+/**
+ * Get next command file event. Never blocks and never makes a system
+ * call. Called from the fieldbus thread.
+ *
+ * @param listener      listener handle
+ * @param event         set to event, if any
+ * @return true if an event was returned
+ */
+bool cmd_listener_get (cmd_listener_t * listener, cmd_event_t * event);
+
+#endif /* CMD_LISTENER_H */
@@ -0,0 +1,663 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Controller emulator for load testing the sample application.
+ *
+ * Runs the application against an emulated mock fieldbus controller
+ * instead of a u-phy core. The cyclic u-phy API calls made by the
+ * application are replaced at link time (--wrap) so that:
+ *
+ * - up_worker() starts a bus cycle every cycle time, changes some of
+ *   the outputs and invokes the application callbacks like the core
+ *   would, in synchronous or free-running mode
+ * - up_read_outputs() hands the emulated outputs to the application
+ *   and up_write_inputs() collects its inputs
+ * - up_param_get_write_req() delivers bursts of parameter writes,
+ *   whose values are verified once the application has applied them.
+ *   With lookup tables the values are kept within the parameter range
+ *   given in the model.
+ *
+ * A cycle starting more than one cycle time late, or callbacks
+ * taking longer than the cycle time, count as missed deadlines. A
+ * JSON report is written after the given duration.
+ */
+
+#include "application.h"
+#include "app_image.h"
+#include "app_lookup.h"
+#include "app_timing.h"
+#include "options.h"
+#include "up_api.h"
+#include "up_util.h"
+#include "model.h"
+#include "osal.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifndef ENABLE_MODEL_LOOKUP
+#define ENABLE_MODEL_LOOKUP 0
+#endif
+
+#define EMU_MAX_BURST 256
+
+/* Interval of the free-running loop indication in synchronous mode */
+#define EMU_LOOP_INTERVAL_US 10000
+
+typedef struct emu_param_write
+{
+   uint16_t slot_ix;
+   uint16_t param_ix;
+   uint32_t seq;
+} emu_param_write_t;
+
+static struct
+{
+   uint32_t cycle_us;
+   uint32_t n_updates;    /**< Outputs changed per cycle */
+   uint32_t burst;        /**< Parameter writes per burst */
+   uint32_t burst_cycles; /**< Cycles between bursts */
+   unsigned int duration;
+   const char * output;
+
+   bool sync; /**< Synchronous mode requested by application */
+   bool running;
+   uint32_t start;
+   uint32_t next;      /**< Time of next cycle */
+   uint32_t next_loop; /**< Time of next loop indication */
+
+   const app_lookup_t * lookup; /**< Lookup tables, or NULL */
+   app_image_t image;
+   uint8_t * outputs; /**< Outputs sent by the controller */
+   uint8_t * inputs;  /**< Inputs received by the controller */
+   uint16_t next_output;
+
+   uint32_t cycles;
+   uint32_t late; /**< Cycles starting more than a cycle late */
+   uint32_t outputs_read;
+   uint32_t inputs_written;
+   uint32_t cycles_without_inputs;
+   uint32_t max_cycles_without_inputs;
+   app_timing_t timing; /**< Callbacks, overrun if above cycle time */
+
+   emu_param_write_t queue[EMU_MAX_BURST];
+   uint32_t n_queued;
+   uint32_t n_fetched;
+   uint32_t param_seq;
+   uint32_t next_param;
+   uint32_t bursts;
+   uint32_t param_writes;
+   uint32_t param_verified;
+   uint32_t param_mismatches;
+   uint32_t param_pending; /**< Writes not fetched by application */
+} emu = {
+   .cycle_us = 1000,
+   .n_updates = 1,
+   .burst = 0,
+   .burst_cycles = 100,
+   .duration = 10,
+};
+
+static const up_param_t * find_param (uint16_t slot_ix, uint16_t param_ix)
+{
+   return &up_device.slots[slot_ix].params[param_ix];
+}
+
+static uint16_t param_length (const up_param_t * p)
+{
+   return (p->bitlength + 7) / 8;
+}
+
+/**
+ * Generate a value within the range of a parameter.
+ *
+ * @return 0 on success, -1 if the parameter has no range
+ */
+static int param_range_value (
+   const app_lookup_param_t * p,
+   uint32_t seq,
+   uint8_t * value)
+{
+   union
+   {
+      int8_t i8;
+      int16_t i16;
+      int32_t i32;
+      uint8_t u8;
+      uint16_t u16;
+      uint32_t u32;
+      float f;
+   } v;
+   uint64_t step = seq * 31ull;
+   int64_t i = 0;
+   uint64_t u = 0;
+   float f = (float)(seq % 100);
+
+   if (!(p->flags & APP_LOOKUP_RANGE))
+   {
+      return -1;
+   }
+
+   if (
+      p->datatype == UP_DTYPE_INT8 || p->datatype == UP_DTYPE_INT16 ||
+      p->datatype == UP_DTYPE_INT32)
+   {
+      i = p->min.i + (int64_t)(step % ((int64_t)p->max.i - p->min.i + 1));
+   }
+   else
+   {
+      u = p->min.u + step % ((uint64_t)p->max.u - p->min.u + 1);
+   }
+
+   switch (p->datatype)
+   {
+   case UP_DTYPE_INT8:
+      v.i8 = (int8_t)i;
+      break;
+   case UP_DTYPE_INT16:
+      v.i16 = (int16_t)i;
+      break;
+   case UP_DTYPE_INT32:
+      v.i32 = (int32_t)i;
+      break;
+   case UP_DTYPE_UINT8:
+      v.u8 = (uint8_t)u;
+      break;
+   case UP_DTYPE_UINT16:
+      v.u16 = (uint16_t)u;
+      break;
+   case UP_DTYPE_UINT32:
+      v.u32 = (uint32_t)u;
+      break;
+   case UP_DTYPE_REAL32:
+      v.f = (f < p->min.f) ? p->min.f : (f > p->max.f) ? p->max.f : f;
+      break;
+   default:
+      return -1;
+   }
+
+   memcpy (value, &v, p->size);
+   return 0;
+}
+
+/**
+ * Generate the value of a parameter write. Deterministic in the
+ * sequence number, so that it can be verified afterwards.
+ */
+static void param_value (
+   uint16_t slot_ix,
+   uint16_t param_ix,
+   uint32_t seq,
+   uint8_t * value,
+   uint16_t length)
+{
+   const app_lookup_param_t * p = NULL;
+   uint16_t i;
+
+   if (emu.lookup != NULL)
+   {
+      p = app_lookup_param (emu.lookup, slot_ix, param_ix);
+   }
+
+   if (
+      p != NULL && p->size == length &&
+      param_range_value (p, seq, value) == 0)
+   {
+      return;
+   }
+
+   for (i = 0; i < length; i++)
+   {
+      value[i] = (uint8_t)(seq * 31 + i);
+   }
+}
+
+/**
+ * Queue a burst of parameter writes, cycling over all parameters of
+ * the device.
+ */
+static void queue_burst (void)
+{
+   uint32_t n_params = 0;
+   uint16_t slot_ix;
+   uint16_t param_ix;
+   uint32_t ix;
+   uint32_t i;
+
+   for (slot_ix = 0; slot_ix < up_device.n_slots; slot_ix++)
+   {
+      n_params += up_device.slots[slot_ix].n_params;
+   }
+
+   emu.n_queued = 0;
+   emu.n_fetched = 0;
+   if (n_params == 0)
+   {
+      return;
+   }
+
+   for (i = 0; i < emu.burst; i++)
+   {
+      ix = emu.next_param++ % n_params;
+      for (slot_ix = 0; ix >= up_device.slots[slot_ix].n_params; slot_ix++)
+      {
+         ix -= up_device.slots[slot_ix].n_params;
+      }
+      param_ix = (uint16_t)ix;
+
+      emu.queue[emu.n_queued].slot_ix = slot_ix;
+      emu.queue[emu.n_queued].param_ix = param_ix;
+      emu.queue[emu.n_queued].seq = ++emu.param_seq;
+      emu.n_queued++;
+   }
+
+   emu.bursts++;
+}
+
+/**
+ * Verify that the last write to each parameter in the burst was
+ * applied by the application.
+ */
+static void verify_burst (void)
+{
+   uint8_t expected[256];
+   const emu_param_write_t * w;
+   const up_param_t * p;
+   uint16_t length;
+   uint32_t i;
+   uint32_t j;
+
+   emu.param_pending += emu.n_queued - emu.n_fetched;
+
+   for (i = 0; i < emu.n_fetched; i++)
+   {
+      w = &emu.queue[i];
+      for (j = i + 1; j < emu.n_fetched; j++)
+      {
+         if (
+            emu.queue[j].slot_ix == w->slot_ix &&
+            emu.queue[j].param_ix == w->param_ix)
+         {
+            break;
+         }
+      }
+      if (j < emu.n_fetched)
+      {
+         /* Overwritten later in the burst */
+         continue;
+      }
+
+      p = find_param (w->slot_ix, w->param_ix);
+      length = param_length (p);
+      if (length > sizeof (expected))
+      {
+         continue;
+      }
+
+      param_value (w->slot_ix, w->param_ix, w->seq, expected, length);
+      if (memcmp (up_vars[p->ix].value, expected, length) == 0)
+      {
+         emu.param_verified++;
+      }
+      else
+      {
+         emu.param_mismatches++;
+      }
+   }
+
+   emu.n_queued = 0;
+   emu.n_fetched = 0;
+}
+
+/**
+ * Change the next n_updates outputs, as a controller would.
+ */
+static void update_outputs (void)
+{
+   const app_image_section_t * section = &emu.image.outputs;
+   const app_image_signal_t * s;
+   uint32_t i;
+   uint16_t j;
+
+   for (i = 0; i < emu.n_updates && section->n_signals > 0; i++)
+   {
+      s = &section->signals[emu.next_output];
+      for (j = 0; j < s->size; j++)
+      {
+         emu.outputs[s->offset + j] = (uint8_t)(emu.cycles >> (8 * (j % 4)));
+      }
+      emu.outputs[section->status_offset + emu.next_output] = UP_STATUS_OK;
+
+      emu.next_output = (emu.next_output + 1) % section->n_signals;
+   }
+}
+
+static void run_cycle (up_t * up)
+{
+   uint32_t inputs_written = emu.inputs_written;
+   uint32_t start;
+
+   emu.cycles++;
+   update_outputs();
+
+   start = app_timing_begin (&emu.timing);
+   if (emu.sync)
+   {
+      app_cfg.avail (up, app_cfg.cb_arg);
+      app_cfg.sync (up, app_cfg.cb_arg);
+   }
+   else
+   {
+      app_cfg.poll_ind (up, app_cfg.cb_arg);
+   }
+
+   if (emu.burst > 0 && emu.cycles % emu.burst_cycles == 0)
+   {
+      queue_burst();
+      if (emu.n_queued > 0)
+      {
+         app_cfg.param_write_ind (up, app_cfg.cb_arg);
+      }
+   }
+   app_timing_end (&emu.timing, start);
+
+   if (emu.n_queued > 0)
+   {
+      verify_burst();
+   }
+
+   if (emu.inputs_written == inputs_written)
+   {
+      emu.cycles_without_inputs++;
+      if (emu.cycles_without_inputs > emu.max_cycles_without_inputs)
+      {
+         emu.max_cycles_without_inputs = emu.cycles_without_inputs;
+      }
+   }
+   else
+   {
+      emu.cycles_without_inputs = 0;
+   }
+}
+
+static void report (FILE * f)
+{
+   uint32_t missed = emu.late + emu.timing.overruns;
+
+   fprintf (f, "{\n");
+   fprintf (f, "  \"model\": \"%s\",\n", up_device.name);
+   fprintf (f, "  \"mode\": \"%s\",\n", emu.sync ? "sync" : "free-running");
+   fprintf (f, "  \"cycle_us\": %" PRIu32 ",\n", emu.cycle_us);
+   fprintf (f, "  \"duration_s\": %u,\n", emu.duration);
+   fprintf (f, "  \"cycles\": %" PRIu32 ",\n", emu.cycles);
+   fprintf (
+      f,
+      "  \"deadlines\": {\"missed\": %" PRIu32 ", \"late\": %" PRIu32
+      ", \"overruns\": %" PRIu32 "},\n",
+      missed,
+      emu.late,
+      emu.timing.overruns);
+   fprintf (
+      f,
+      "  \"outputs_read\": %" PRIu32 ", \"inputs_written\": %" PRIu32
+      ", \"max_cycles_without_inputs\": %" PRIu32 ",\n",
+      emu.outputs_read,
+      emu.inputs_written,
+      emu.max_cycles_without_inputs);
+   fprintf (
+      f,
+      "  \"params\": {\"bursts\": %" PRIu32 ", \"writes\": %" PRIu32
+      ", \"verified\": %" PRIu32 ", \"mismatches\": %" PRIu32
+      ", \"pending\": %" PRIu32 "},\n",
+      emu.bursts,
+      emu.param_writes,
+      emu.param_verified,
+      emu.param_mismatches,
+      emu.param_pending);
+   fprintf (f, "  \"timing\": ");
+   app_timing_write_json (&emu.timing, f);
+   fprintf (f, ",\n  \"app\": ");
+   app_write_stats (f);
+   fprintf (f, "\n}\n");
+}
+
+static void finish (void)
+{
+   FILE * f = stdout;
+
+   if (emu.output != NULL)
+   {
+      f = fopen (emu.output, "w");
+      if (f == NULL)
+      {
+         printf ("Failed to open %s\n", emu.output);
+         exit (EXIT_FAILURE);
+      }
+   }
+
+   report (f);
+   if (f != stdout)
+   {
+      fclose (f);
+   }
+
+   exit ((emu.param_mismatches == 0 && emu.param_pending == 0)
+            ? EXIT_SUCCESS
+            : EXIT_FAILURE);
+}
+
+/* Emulated core API */
+
+int __wrap_up_start_device (up_t * up)
+{
+   emu.running = true;
+   emu.start = os_get_current_time_us();
+   emu.next = emu.start + emu.cycle_us;
+   emu.next_loop = emu.start + EMU_LOOP_INTERVAL_US;
+   return 0;
+}
+
+int __wrap_up_write_event_mask (up_t * up, uint32_t mask)
+{
+   emu.sync = (mask & UP_EVENT_MASK_SYNCHRONOUS_MODE) != 0;
+   return 0;
+}
+
+int __wrap_up_enable_watchdog (up_t * up, bool enable)
+{
+   return 0;
+}
+
+int __wrap_up_read_outputs (up_t * up)
+{
+   app_image_unpack (&emu.image, &emu.image.outputs, emu.outputs);
+   emu.outputs_read++;
+   return 0;
+}
+
+int __wrap_up_write_inputs (up_t * up)
+{
+   app_image_pack (&emu.image, &emu.image.inputs, emu.inputs);
+   emu.inputs_written++;
+   return 0;
+}
+
+int __wrap_up_param_get_write_req (
+   up_t * up,
+   uint16_t * slot_ix,
+   uint16_t * param_ix,
+   binary_t * data)
+{
+   const emu_param_write_t * w;
+   const up_param_t * p;
+
+   if (emu.n_fetched == emu.n_queued)
+   {
+      return -1;
+   }
+
+   w = &emu.queue[emu.n_fetched++];
+   p = find_param (w->slot_ix, w->param_ix);
+
+   /* Ownership of the value passes to the caller */
+   data->dataLength = param_length (p);
+   data->data = malloc (data->dataLength + 1);
+   if (data->data == NULL)
+   {
+      return -1;
+   }
+   param_value (
+      w->slot_ix,
+      w->param_ix,
+      w->seq,
+      data->data,
+      data->dataLength);
+
+   *slot_ix = w->slot_ix;
+   *param_ix = w->param_ix;
+   emu.param_writes++;
+   return 0;
+}
+
+bool __wrap_up_worker (up_t * up)
+{
+   uint32_t now = os_get_current_time_us();
+
+   if (!emu.running)
+   {
+      return false;
+   }
+
+   if (now - emu.start >= emu.duration * 1000000u)
+   {
+      finish();
+   }
+
+   if ((int32_t)(now - emu.next) >= 0)
+   {
+      if (now - emu.next > emu.cycle_us)
+      {
+         /* Application did not return in time, restart schedule */
+         emu.late++;
+         emu.next = now;
+      }
+      emu.next += emu.cycle_us;
+      run_cycle (up);
+   }
+
+   /* The loop indication also drives status and statistics */
+   if (emu.sync && (int32_t)(now - emu.next_loop) >= 0)
+   {
+      emu.next_loop += EMU_LOOP_INTERVAL_US;
+      app_cfg.poll_ind (up, app_cfg.cb_arg);
+   }
+
+   return true;
+}
+
+static const char emu_help[] =
+   "Run the sample application against an emulated controller on\n"
+   "the mock fieldbus.\n"
+   "\nUsage: sample-emu [options]\n"
+   "\nOptions:\n"
+   "  -c <us>        cycle time (default 1000)\n"
+   "  -u <n>         outputs changed per cycle (default 1)\n"
+   "  -p <n>         parameter writes per burst (default 0, no bursts)\n"
+   "  -b <cycles>    cycles between parameter bursts (default 100)\n"
+   "  -d <seconds>   duration (default 10)\n"
+   "  -o <file>      write JSON report to file (default stdout)\n";
+
+int main (int argc, char * argv[])
+{
+   up_t * up;
+   int opt;
+
+   setvbuf (stdout, NULL, _IONBF, 0);
+
+   while ((opt = getopt (argc, argv, "c:u:p:b:d:o:")) != -1)
+   {
+      switch (opt)
+      {
+      case 'c':
+         emu.cycle_us = strtoul (optarg, NULL, 0);
+         break;
+      case 'u':
+         emu.n_updates = strtoul (optarg, NULL, 0);
+         break;
+      case 'p':
+         emu.burst = strtoul (optarg, NULL, 0);
+         break;
+      case 'b':
+         emu.burst_cycles = strtoul (optarg, NULL, 0);
+         break;
+      case 'd':
+         emu.duration = strtoul (optarg, NULL, 0);
+         break;
+      case 'o':
+         emu.output = optarg;
+         break;
+      default:
+         puts (emu_help);
+         exit (EXIT_FAILURE);
+      }
+   }
+
+   if (
+      optind != argc || emu.cycle_us == 0 || emu.burst > EMU_MAX_BURST ||
+      emu.burst_cycles == 0 || emu.duration == 0)
+   {
+      puts (emu_help);
+      exit (EXIT_FAILURE);
+   }
+
+   app_cfg.device->bustype = UP_BUSTYPE_MOCK;
+   app_busconf.mock = up_mock_config;
+
+   if (app_image_init (&emu.image, &up_device, up_vars) != 0)
+   {
+      printf ("Failed to init process image\n");
+      exit (EXIT_FAILURE);
+   }
+
+   emu.outputs = calloc (1, emu.image.outputs.size + 1);
+   emu.inputs = calloc (1, emu.image.inputs.size + 1);
+   if (emu.outputs == NULL || emu.inputs == NULL)
+   {
+      printf ("Failed to allocate process data\n");
+      exit (EXIT_FAILURE);
+   }
+   app_timing_init (&emu.timing, "cycle", emu.cycle_us);
+
+#if ENABLE_MODEL_LOOKUP
+   if (app_lookup_check (&model_lookup, &up_device) == 0)
+   {
+      emu.lookup = &model_lookup;
+   }
+#endif
+
+   up = up_init (&app_cfg);
+   if (up == NULL || up_util_init (&up_device, up, up_vars) != 0)
+   {
+      printf ("Failed to init u-phy\n");
+      exit (EXIT_FAILURE);
+   }
+
+   /* Busy poll, the emulator schedules cycles from up_worker() */
+   app_set_worker_idle (0);
+   app_main (up);
+
+   return 0;
+}
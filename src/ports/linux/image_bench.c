@@ -0,0 +1,236 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Benchmark of process image packing.
+ *
+ * Checks that the process image built at runtime by app_image_init()
+ * matches the layout generated from the model (model_image.h), then
+ * compares packing the inputs from up_vars and unpacking the outputs
+ * to up_vars with the runtime layout (app_image_pack/unpack) and with
+ * the generated functions, which use compile-time offsets and sizes.
+ * Both variants move the same data between up_vars and a packed
+ * image. Results are written as JSON.
+ */
+
+#include "app_image.h"
+#include "options.h"
+#include "up_api.h"
+#include "model.h"
+#include "model_image.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if UP_IMAGE_AVAILABLE
+/* Keep the compiler from optimising away copies to buf */
+#define CLOBBER(buf) __asm__ volatile ("" : : "r"(buf) : "memory")
+
+static uint64_t now_ns (void)
+{
+   struct timespec ts;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static int check_section (
+   const char * name,
+   const app_image_section_t * section,
+   uint32_t size,
+   uint32_t status_offset,
+   const uint32_t * offsets,
+   const uint16_t * indices,
+   uint16_t n_signals)
+{
+   uint16_t i;
+
+   if (
+      section->size != size || section->status_offset != status_offset ||
+      section->n_signals != n_signals)
+   {
+      printf ("%s: layout does not match model_image.h\n", name);
+      return -1;
+   }
+
+   for (i = 0; i < section->n_signals; i++)
+   {
+      if (
+         section->signals[i].offset != offsets[i] ||
+         section->signals[i].ix != indices[i])
+      {
+         printf (
+            "%s: %s.%s at offset %" PRIu32 " index %u, expected %" PRIu32
+            " index %u\n",
+            name,
+            section->signals[i].slot,
+            section->signals[i].name,
+            section->signals[i].offset,
+            section->signals[i].ix,
+            offsets[i],
+            indices[i]);
+         return -1;
+      }
+   }
+
+   return 0;
+}
+
+int main (int argc, char * argv[])
+{
+   static const uint32_t input_offsets[] = UP_IMAGE_INPUTS_OFFSETS;
+   static const uint32_t output_offsets[] = UP_IMAGE_OUTPUTS_OFFSETS;
+   static const uint16_t input_indices[] = UP_IMAGE_INPUTS_INDICES;
+   static const uint16_t output_indices[] = UP_IMAGE_OUTPUTS_INDICES;
+   unsigned long n = 100000;
+   const char * output = NULL;
+   app_image_t image;
+   up_image_inputs_t * inputs[2];
+   up_image_outputs_t * outputs;
+   uint64_t t[5];
+   unsigned long i;
+   FILE * f = stdout;
+   int opt;
+
+   while ((opt = getopt (argc, argv, "n:o:")) != -1)
+   {
+      switch (opt)
+      {
+      case 'n':
+         n = strtoul (optarg, NULL, 0);
+         break;
+      case 'o':
+         output = optarg;
+         break;
+      default:
+         printf ("Usage: %s [-n iterations] [-o output.json]\n", argv[0]);
+         exit (EXIT_FAILURE);
+      }
+   }
+
+   if (n == 0 || app_image_init (&image, &up_device, up_vars) != 0)
+   {
+      printf ("Failed to init process image\n");
+      exit (EXIT_FAILURE);
+   }
+
+   if (
+      check_section (
+         "inputs",
+         &image.inputs,
+         UP_IMAGE_INPUTS_SIZE,
+         UP_IMAGE_INPUTS_STATUS_OFFSET,
+         input_offsets,
+         input_indices,
+         UP_IMAGE_INPUTS_COUNT) != 0 ||
+      check_section (
+         "outputs",
+         &image.outputs,
+         UP_IMAGE_OUTPUTS_SIZE,
+         UP_IMAGE_OUTPUTS_STATUS_OFFSET,
+         output_offsets,
+         output_indices,
+         UP_IMAGE_OUTPUTS_COUNT) != 0)
+   {
+      exit (EXIT_FAILURE);
+   }
+
+   inputs[0] = calloc (1, sizeof (up_image_inputs_t));
+   inputs[1] = calloc (1, sizeof (up_image_inputs_t));
+   outputs = calloc (1, sizeof (up_image_outputs_t));
+   if (inputs[0] == NULL || inputs[1] == NULL || outputs == NULL)
+   {
+      printf ("Failed to allocate images\n");
+      exit (EXIT_FAILURE);
+   }
+
+   t[0] = now_ns();
+   for (i = 0; i < n; i++)
+   {
+      app_image_pack (&image, &image.inputs, (uint8_t *)inputs[0]);
+      CLOBBER (inputs[0]);
+   }
+   t[1] = now_ns();
+   for (i = 0; i < n; i++)
+   {
+      up_image_inputs_pack (inputs[1], up_vars);
+      CLOBBER (inputs[1]);
+   }
+   t[2] = now_ns();
+   for (i = 0; i < n; i++)
+   {
+      app_image_unpack (&image, &image.outputs, (uint8_t *)outputs);
+      CLOBBER (outputs);
+   }
+   t[3] = now_ns();
+   for (i = 0; i < n; i++)
+   {
+      up_image_outputs_unpack (outputs, up_vars);
+      CLOBBER (outputs);
+   }
+   t[4] = now_ns();
+
+   if (memcmp (inputs[0], inputs[1], UP_IMAGE_INPUTS_SIZE) != 0)
+   {
+      printf ("Generated and runtime packing differ\n");
+      exit (EXIT_FAILURE);
+   }
+
+   if (output != NULL)
+   {
+      f = fopen (output, "w");
+      if (f == NULL)
+      {
+         printf ("Failed to open %s\n", output);
+         exit (EXIT_FAILURE);
+      }
+   }
+
+   fprintf (f, "{\n");
+   fprintf (f, "  \"model\": \"%s\",\n", up_device.name);
+   fprintf (f, "  \"iterations\": %lu,\n", n);
+   fprintf (
+      f,
+      "  \"inputs\": {\"signals\": %u, \"bytes\": %u, "
+      "\"runtime_ns\": %.1f, \"generated_ns\": %.1f},\n",
+      UP_IMAGE_INPUTS_COUNT,
+      UP_IMAGE_INPUTS_SIZE,
+      (double)(t[1] - t[0]) / n,
+      (double)(t[2] - t[1]) / n);
+   fprintf (
+      f,
+      "  \"outputs\": {\"signals\": %u, \"bytes\": %u, "
+      "\"runtime_ns\": %.1f, \"generated_ns\": %.1f}\n",
+      UP_IMAGE_OUTPUTS_COUNT,
+      UP_IMAGE_OUTPUTS_SIZE,
+      (double)(t[3] - t[2]) / n,
+      (double)(t[4] - t[3]) / n);
+   fprintf (f, "}\n");
+
+   if (f != stdout)
+   {
+      fclose (f);
+   }
+
+   return 0;
+}
+#else
+int main (int argc, char * argv[])
+{
+   printf ("No packed layout generated for %s\n", up_device.name);
+   return 0;
+}
+#endif
@@ -11,11 +11,14 @@
  ********************************************************************/
 
 #include "application.h"
+#include "app_eeprom.h"
 #include "options.h"
 #include "up_api.h"
 #include "up_util.h"
 #include "model.h"
+#include "rt.h"
 
+#include <signal.h>
 #include <stdio.h>
 
 extern void up_core_init (void);
@@ -36,17 +39,7 @@ static void main_entry (up_t * up)
 #if defined (UP_DEVICE_ETHERCAT_SUPPORTED)
       if (app_cfg.device->bustype == UP_BUSTYPE_ECAT)
       {
-         /* Start and end tags for the generated EtherCAT SII eeprom.
-          * Defined in eeprom.S.
-          */
-         extern const uint8_t _eeprom_bin_start;
-         extern const uint8_t _eeprom_bin_end;
-
-         if (
-            up_write_ecat_eeprom (
-               up,
-               &_eeprom_bin_start,
-               &_eeprom_bin_end - &_eeprom_bin_start) != 0)
+         if (app_eeprom_write (up) != 0)
          {
             printf ("Failed to write EtherCAT eeprom \n");
             return;
@@ -119,6 +112,9 @@ static int _cmd_start (int argc, char * argv[])
    printf ("Starting sample application\n");
    up = up_init (&app_cfg);
 
+   /* Print statistics when the application exits */
+   atexit (app_show_stats);
+
    main_entry (up);
 
    return 0;
@@ -126,7 +122,7 @@ static int _cmd_start (int argc, char * argv[])
 
 static char cmd_start_help_long[] =
    "Start monolithic u-phy device including core and device model.\n"
-   "Usage: up_start <fieldbus> <network interface>\n"
+   "Usage: up_start [options] <fieldbus> <network interface>\n"
    "where fieldbus can be one of:\n"
 #if UP_DEVICE_ETHERCAT_SUPPORTED
    "  - ethercat\n"
@@ -143,16 +139,55 @@ static char cmd_start_help_long[] =
 #if UP_DEVICE_CCLINK_SUPPORTED
    "  - cclink\n"
 #endif
-   "  - mock\n";
+   "  - mock\n"
+   RT_HELP;
+
+static void signal_stats (int sig)
+{
+   app_request_stats();
+}
+
+static void signal_dump (int sig)
+{
+   app_request_recorder_dump();
+}
 
 int main (int argc, char * argv[])
 {
+   rt_cfg_t rt_cfg;
+   int argi;
+
+   setvbuf (stdout, NULL, _IONBF, 0);
+   signal (SIGUSR1, signal_stats);
+   signal (SIGUSR2, signal_dump);
+
+   /* Apply real-time profile before any core thread is created, so
+      that all threads inherit it */
+   argi = rt_parse_args (&rt_cfg, argc, argv);
+   if (argi > 0 && rt_enabled (&rt_cfg))
+   {
+      if (rt_apply (&rt_cfg) != 0)
+      {
+         exit (EXIT_FAILURE);
+      }
+   }
+
+   if (argi > 0 && rt_cfg.idle_ms >= 0)
+   {
+      app_set_worker_idle (rt_cfg.idle_ms);
+   }
+
    /* Initialise U-Phy */
    up_core_init();
    up_core_set_status (UP_CORE_CONNECTED);
 
-   setvbuf (stdout, NULL, _IONBF, 0);
-   if (_cmd_start (argc, argv) != 0)
+   /* Drop options, keep program name */
+   if (argi > 0)
+   {
+      argv[argi - 1] = argv[0];
+   }
+
+   if (argi < 0 || _cmd_start (argc - argi + 1, &argv[argi - 1]) != 0)
    {
       puts (cmd_start_help_long);
       printf ("Example:\n%s profinet eth0\n", argv[0]);
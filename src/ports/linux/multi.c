@@ -0,0 +1,558 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Host process driving several u-phy cores.
+ *
+ * Each core gets its own up_t instance, transport and copy of the
+ * process data, reached through a relocated copy of up_vars. Devices
+ * are distributed over a small pool of worker threads, each calling
+ * up_worker() for its devices in turn. The cyclic callback of every
+ * device reads outputs and writes inputs, and its execution time and
+ * interval are recorded. An interval above the deadline counts as a
+ * missed cycle. Parameter writes are drained in batches into the
+ * process data of the device. A device that cannot be started, or
+ * that loses its core, is marked down and handed to a start thread of
+ * its own, which retries with backoff. Starting makes blocking calls
+ * to the core, so the worker threads keep driving the other devices
+ * meanwhile. With -d, a JSON report is written after the given time,
+ * showing how many devices kept their deadline.
+ */
+
+#include "app_eeprom.h"
+#include "app_image.h"
+#include "app_param.h"
+#include "app_timing.h"
+#include "options.h"
+#include "up_api.h"
+#include "model.h"
+#include "osal.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MULTI_MAX_DEVICES 64
+#define MULTI_MAX_THREADS 16
+
+#define MULTI_PARAM_BATCH_SIZE 16
+
+/* Delay before restarting a device that is down, doubled after each
+   failed start */
+#define MULTI_RETRY_MIN_US 100000
+#define MULTI_RETRY_MAX_US 5000000
+
+typedef struct multi_device
+{
+   unsigned int id;
+   char * scheme;
+   char * transport;
+   up_t * up;
+   up_cfg_t cfg;
+   up_busconf_t busconf;
+   up_data_t data;
+   up_signal_info_t * vars;
+   app_param_write_t param_reqs[MULTI_PARAM_BATCH_SIZE];
+   app_param_batch_t params;
+   pthread_mutex_t lock; /**< Protects state and counters below */
+   bool running;         /**< Started and connected to core */
+   bool starting;        /**< Start thread owns the device */
+   uint32_t deadline_misses;
+   uint32_t disconnects;
+   uint32_t start_failures;
+   app_timing_t timing;
+} multi_device_t;
+
+static struct
+{
+   unsigned int n_threads;
+   unsigned int duration;
+   uint32_t deadline;
+   uint32_t idle_us;
+   up_bustype_t bustype;
+   uint16_t n_vars;
+   unsigned int n_devices;
+   multi_device_t devices[MULTI_MAX_DEVICES];
+   pthread_mutex_t eeprom_lock;
+} multi = {
+   .n_threads = 1,
+   .duration = 0,
+   .deadline = 15000,
+   .idle_us = 0,
+   .eeprom_lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static void cb_poll_ind (up_t * up, void * user_arg)
+{
+   multi_device_t * dev = user_arg;
+   bool started = dev->timing.started;
+   uint32_t last_start = dev->timing.last_start;
+   uint32_t start;
+
+   start = app_timing_begin (&dev->timing);
+   if (started && start - last_start > multi.deadline)
+   {
+      dev->deadline_misses++;
+   }
+
+   up_read_outputs (up);
+   up_write_inputs (up);
+
+   app_timing_end (&dev->timing, start);
+}
+
+static void cb_param_write_ind (up_t * up, void * user_arg)
+{
+   multi_device_t * dev = user_arg;
+
+   while (app_param_batch_get (&dev->params, up) > 0)
+   {
+      app_param_batch_apply (&dev->params, dev->vars);
+   }
+}
+
+static void cb_error_ind (up_t * up, up_error_t error_code, void * user_arg)
+{
+   multi_device_t * dev = user_arg;
+
+   printf (
+      "Device %u: error_code=%" PRIi16 " %s\n",
+      dev->id,
+      error_code,
+      up_error_to_str (error_code));
+}
+
+static int set_busconf (up_busconf_t * busconf, up_bustype_t bustype)
+{
+   switch (bustype)
+   {
+#if UP_DEVICE_PROFINET_SUPPORTED
+   case UP_BUSTYPE_PROFINET:
+      busconf->profinet = up_profinet_config;
+      break;
+#endif
+#if UP_DEVICE_ETHERCAT_SUPPORTED
+   case UP_BUSTYPE_ECAT:
+      busconf->ecat = up_ethercat_config;
+      break;
+#endif
+#if UP_DEVICE_ETHERNETIP_SUPPORTED
+   case UP_BUSTYPE_ETHERNETIP:
+      busconf->ethernetip = up_ethernetip_config;
+      break;
+#endif
+#if UP_DEVICE_MODBUS_SUPPORTED
+   case UP_BUSTYPE_MODBUS:
+      busconf->modbus = up_modbus_config;
+      break;
+#endif
+#if UP_DEVICE_CCLINK_SUPPORTED
+   case UP_BUSTYPE_CCLINK:
+      busconf->cclink = up_cclink_config;
+      break;
+#endif
+   case UP_BUSTYPE_MOCK:
+      busconf->mock = up_mock_config;
+      break;
+   default:
+      return -1;
+   }
+
+   return 0;
+}
+
+static int device_init (multi_device_t * dev)
+{
+   int error = -1;
+
+   /* Private copy of the process data */
+   memcpy (&dev->data, &up_data, sizeof (dev->data));
+   dev->vars = calloc (multi.n_vars, sizeof (up_signal_info_t));
+   if (dev->vars == NULL)
+   {
+      return -1;
+   }
+   app_image_relocate (
+      up_vars,
+      dev->vars,
+      multi.n_vars,
+      &up_data,
+      &dev->data,
+      sizeof (up_data));
+
+   if (set_busconf (&dev->busconf, multi.bustype) != 0)
+   {
+      return -1;
+   }
+
+   if (
+      app_param_batch_init (
+         &dev->params,
+         &up_device,
+         dev->param_reqs,
+         MULTI_PARAM_BATCH_SIZE) != 0)
+   {
+      return -1;
+   }
+
+   dev->cfg.device = &up_device;
+   dev->cfg.busconf = &dev->busconf;
+   dev->cfg.vars = dev->vars;
+   dev->cfg.error_ind = cb_error_ind;
+   dev->cfg.poll_ind = cb_poll_ind;
+   dev->cfg.param_write_ind = cb_param_write_ind;
+   dev->cfg.cb_arg = dev;
+
+   if (pthread_mutex_init (&dev->lock, NULL) != 0)
+   {
+      return -1;
+   }
+
+   app_timing_init (&dev->timing, dev->transport, multi.deadline);
+
+   dev->up = up_init (&dev->cfg);
+   if (dev->up == NULL)
+   {
+      return -1;
+   }
+
+#if defined(OPTION_TRANSPORT_TCP)
+   if (strcmp (dev->scheme, "tcp") == 0)
+   {
+      error = up_tcp_transport_init (dev->up, dev->transport, 5150);
+   }
+#endif
+#if defined(OPTION_TRANSPORT_UART)
+   if (strcmp (dev->scheme, "uart") == 0)
+   {
+      error = up_serial_transport_init (dev->up, dev->transport);
+   }
+#endif
+   if (error != 0)
+   {
+      printf ("Device %u: failed to bring up transport\n", dev->id);
+      return -1;
+   }
+
+   if (up_rpc_init (dev->up) != 0)
+   {
+      printf ("Device %u: failed to init rpc\n", dev->id);
+      return -1;
+   }
+
+   return 0;
+}
+
+static int device_start (multi_device_t * dev)
+{
+   if (up_rpc_start (dev->up, true) != 0)
+   {
+      printf ("Device %u: failed to connect to u-phy core\n", dev->id);
+      return -1;
+   }
+
+   if (up_init_device (dev->up) != 0)
+   {
+      printf ("Device %u: failed to configure device\n", dev->id);
+      return -1;
+   }
+
+#if defined(UP_DEVICE_ETHERCAT_SUPPORTED)
+   if (multi.bustype == UP_BUSTYPE_ECAT)
+   {
+      int error;
+
+      /* The eeprom image state is shared by all devices */
+      pthread_mutex_lock (&multi.eeprom_lock);
+      error = app_eeprom_write (dev->up);
+      pthread_mutex_unlock (&multi.eeprom_lock);
+      if (error != 0)
+      {
+         printf ("Device %u: failed to write EtherCAT eeprom\n", dev->id);
+         return -1;
+      }
+   }
+#endif
+
+   if (up_start_device (dev->up) != 0)
+   {
+      printf ("Device %u: failed to start device\n", dev->id);
+      return -1;
+   }
+
+   if (up_enable_watchdog (dev->up, true) != 0)
+   {
+      printf ("Device %u: failed to enable watchdog\n", dev->id);
+      return -1;
+   }
+
+   up_write_inputs (dev->up);
+   return 0;
+}
+
+/**
+ * Start a device that is down, retrying with a delay that doubles up
+ * to MULTI_RETRY_MAX_US. Runs on a thread of its own, as starting
+ * blocks on the core. The worker thread does not touch the device
+ * until it is marked running.
+ */
+static void * start_thread (void * arg)
+{
+   multi_device_t * dev = arg;
+   uint32_t retry_us = MULTI_RETRY_MIN_US;
+
+   while (device_start (dev) != 0)
+   {
+      pthread_mutex_lock (&dev->lock);
+      dev->start_failures++;
+      pthread_mutex_unlock (&dev->lock);
+
+      os_usleep (retry_us);
+      retry_us = (retry_us < MULTI_RETRY_MAX_US / 2) ? retry_us * 2
+                                                     : MULTI_RETRY_MAX_US;
+   }
+
+   pthread_mutex_lock (&dev->lock);
+   dev->running = true;
+   dev->starting = false;
+   pthread_mutex_unlock (&dev->lock);
+
+   return NULL;
+}
+
+/**
+ * Hand a device that is down to a new start thread. If no thread can
+ * be created, this is tried again on the next pass.
+ */
+static void device_restart (multi_device_t * dev)
+{
+   pthread_attr_t attr;
+   pthread_t thread;
+
+   pthread_attr_init (&attr);
+   pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+   dev->starting = pthread_create (&thread, &attr, start_thread, dev) == 0;
+   pthread_attr_destroy (&attr);
+}
+
+static void * worker_thread (void * arg)
+{
+   unsigned int first = (uintptr_t)arg;
+   unsigned int i;
+   bool any_running;
+
+   for (;;)
+   {
+      any_running = false;
+
+      /* Devices are distributed round-robin over the threads */
+      for (i = first; i < multi.n_devices; i += multi.n_threads)
+      {
+         multi_device_t * dev = &multi.devices[i];
+
+         pthread_mutex_lock (&dev->lock);
+         if (dev->running && !up_worker (dev->up))
+         {
+            printf ("Device %u: restart\n", dev->id);
+            dev->running = false;
+            dev->disconnects++;
+            dev->timing.started = false;
+         }
+
+         if (!dev->running && !dev->starting)
+         {
+            device_restart (dev);
+         }
+
+         any_running |= dev->running;
+         pthread_mutex_unlock (&dev->lock);
+      }
+
+      if (multi.idle_us > 0)
+      {
+         os_usleep (multi.idle_us);
+      }
+      else if (!any_running)
+      {
+         /* Nothing to drive until a start thread is done */
+         os_usleep (1000);
+      }
+   }
+
+   return NULL;
+}
+
+static void report (FILE * f)
+{
+   unsigned int n_ok = 0;
+   unsigned int i;
+
+   fprintf (f, "{\n");
+   fprintf (f, "  \"model\": \"%s\",\n", up_device.name);
+   fprintf (f, "  \"threads\": %u,\n", multi.n_threads);
+   fprintf (f, "  \"deadline_us\": %" PRIu32 ",\n", multi.deadline);
+   fprintf (f, "  \"duration_s\": %u,\n", multi.duration);
+   fprintf (f, "  \"devices\": [\n");
+   for (i = 0; i < multi.n_devices; i++)
+   {
+      multi_device_t * dev = &multi.devices[i];
+
+      /* Counters are updated by the worker and start threads */
+      pthread_mutex_lock (&dev->lock);
+      if (
+         dev->running && dev->deadline_misses == 0 &&
+         dev->disconnects == 0 && dev->timing.interval.count > 0)
+      {
+         n_ok++;
+      }
+
+      fprintf (
+         f,
+         "    {\"transport\": \"%s:%s\", \"running\": %s"
+         ", \"disconnects\": %" PRIu32 ", \"start_failures\": %" PRIu32
+         ", \"deadline_misses\": %" PRIu32 ", \"param_writes\": %" PRIu32
+         ", \"param_writes_rejected\": %" PRIu32 ", \"timing\": ",
+         dev->scheme,
+         dev->transport,
+         dev->running ? "true" : "false",
+         dev->disconnects,
+         dev->start_failures,
+         dev->deadline_misses,
+         dev->params.n_writes,
+         dev->params.n_rejected);
+      app_timing_write_json (&dev->timing, f);
+      pthread_mutex_unlock (&dev->lock);
+      fprintf (f, "}%s\n", (i + 1 < multi.n_devices) ? "," : "");
+   }
+   fprintf (f, "  ],\n");
+   fprintf (f, "  \"devices_within_deadline\": %u\n", n_ok);
+   fprintf (f, "}\n");
+}
+
+static const char multi_help[] =
+   "Drive several u-phy cores from one process.\n"
+   "\nUsage: sample-multi [options] <scheme:transport>...\n"
+   "\nwhere scheme:transport can be one of:\n"
+#if defined(OPTION_TRANSPORT_TCP)
+   "  - tcp:<address>\n"
+#endif
+#if defined(OPTION_TRANSPORT_UART)
+   "  - uart:<serial port>\n"
+#endif
+   "\nOptions:\n"
+   "  -f <fieldbus>  fieldbus for all devices (default mock)\n"
+   "  -t <threads>   number of worker threads (default 1)\n"
+   "  -m <us>        cycle deadline (default 15000)\n"
+   "  -i <us>        sleep after each pass over the devices (default 0)\n"
+   "  -d <seconds>   exit after time and write JSON report (default "
+   "run forever)\n";
+
+int main (int argc, char * argv[])
+{
+   pthread_t threads[MULTI_MAX_THREADS];
+   char * saveptr;
+   unsigned int i;
+   int opt;
+
+   setvbuf (stdout, NULL, _IONBF, 0);
+   multi.bustype = UP_BUSTYPE_MOCK;
+
+   while ((opt = getopt (argc, argv, "f:t:m:i:d:")) != -1)
+   {
+      switch (opt)
+      {
+      case 'f':
+         multi.bustype = up_str_to_bustype (optarg);
+         break;
+      case 't':
+         multi.n_threads = strtoul (optarg, NULL, 0);
+         break;
+      case 'm':
+         multi.deadline = strtoul (optarg, NULL, 0);
+         break;
+      case 'i':
+         multi.idle_us = strtoul (optarg, NULL, 0);
+         break;
+      case 'd':
+         multi.duration = strtoul (optarg, NULL, 0);
+         break;
+      default:
+         puts (multi_help);
+         exit (EXIT_FAILURE);
+      }
+   }
+
+   multi.n_devices = argc - optind;
+   if (
+      multi.n_devices == 0 || multi.n_devices > MULTI_MAX_DEVICES ||
+      multi.n_threads == 0 || multi.n_threads > MULTI_MAX_THREADS)
+   {
+      puts (multi_help);
+      exit (EXIT_FAILURE);
+   }
+
+   if (multi.n_threads > multi.n_devices)
+   {
+      multi.n_threads = multi.n_devices;
+   }
+
+   /* All devices share the model, and thus the bus type */
+   up_device.bustype = multi.bustype;
+   multi.n_vars = app_image_n_vars (&up_device);
+
+   for (i = 0; i < multi.n_devices; i++)
+   {
+      multi_device_t * dev = &multi.devices[i];
+
+      dev->id = i;
+      dev->scheme = strtok_r (argv[optind + i], ":", &saveptr);
+      dev->transport = strtok_r (NULL, "", &saveptr);
+      if (dev->scheme == NULL || dev->transport == NULL)
+      {
+         puts (multi_help);
+         exit (EXIT_FAILURE);
+      }
+
+      if (device_init (dev) != 0)
+      {
+         printf ("Device %u: failed to initialise\n", i);
+         exit (EXIT_FAILURE);
+      }
+   }
+
+   for (i = 0; i < multi.n_threads; i++)
+   {
+      if (
+         pthread_create (
+            &threads[i],
+            NULL,
+            worker_thread,
+            (void *)(uintptr_t)i) != 0)
+      {
+         printf ("Failed to start worker thread\n");
+         exit (EXIT_FAILURE);
+      }
+   }
+
+   if (multi.duration == 0)
+   {
+      pthread_join (threads[0], NULL);
+      return 0;
+   }
+
+   sleep (multi.duration);
+   report (stdout);
+   exit (EXIT_SUCCESS);
+}
@@ -0,0 +1,301 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#include "pimage.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PIMAGE_ALIGN 64
+
+struct pimage
+{
+   pimage_header_t * hdr;
+   size_t size;
+   char * name; /**< Set if image is owned by this handle */
+};
+
+static uint32_t align_up (uint32_t value)
+{
+   return (value + PIMAGE_ALIGN - 1) & ~(uint32_t)(PIMAGE_ALIGN - 1);
+}
+
+static uint8_t * bank_ptr (
+   const pimage_t * img,
+   pimage_dir_t dir,
+   uint32_t bank)
+{
+   return (uint8_t *)img->hdr + img->hdr->section[dir].bank[bank & 1];
+}
+
+pimage_t * pimage_create (
+   const char * name,
+   const pimage_signal_t * signals,
+   uint32_t n_signals,
+   uint32_t input_size,
+   uint32_t output_size)
+{
+   pimage_t * img;
+   pimage_header_t * hdr;
+   uint32_t sizes[2] = {input_size, output_size};
+   uint32_t offset;
+   int dir;
+   int fd;
+
+   img = calloc (1, sizeof (*img));
+   if (img == NULL)
+   {
+      return NULL;
+   }
+
+   /* Compute layout */
+   offset = align_up (sizeof (pimage_header_t));
+   offset += align_up (n_signals * sizeof (pimage_signal_t));
+   for (dir = 0; dir < 2; dir++)
+   {
+      offset += 2 * align_up (sizes[dir]);
+   }
+   img->size = offset;
+
+   shm_unlink (name);
+   fd = shm_open (name, O_CREAT | O_EXCL | O_RDWR, 0660);
+   if (fd < 0)
+   {
+      free (img);
+      return NULL;
+   }
+
+   if (ftruncate (fd, img->size) != 0)
+   {
+      close (fd);
+      shm_unlink (name);
+      free (img);
+      return NULL;
+   }
+
+   hdr = mmap (NULL, img->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close (fd);
+   if (hdr == MAP_FAILED)
+   {
+      shm_unlink (name);
+      free (img);
+      return NULL;
+   }
+
+   img->hdr = hdr;
+   img->name = strdup (name);
+   if (img->name == NULL)
+   {
+      munmap (hdr, img->size);
+      shm_unlink (name);
+      free (img);
+      return NULL;
+   }
+
+   hdr->version = PIMAGE_VERSION;
+   hdr->total_size = img->size;
+   hdr->n_signals = n_signals;
+   hdr->signals_offset = align_up (sizeof (pimage_header_t));
+   memcpy (
+      (uint8_t *)hdr + hdr->signals_offset,
+      signals,
+      n_signals * sizeof (pimage_signal_t));
+
+   offset = hdr->signals_offset +
+            align_up (n_signals * sizeof (pimage_signal_t));
+   for (dir = 0; dir < 2; dir++)
+   {
+      atomic_init (&hdr->section[dir].seq, 0);
+      hdr->section[dir].size = sizes[dir];
+      hdr->section[dir].bank[0] = offset;
+      offset += align_up (sizes[dir]);
+      hdr->section[dir].bank[1] = offset;
+      offset += align_up (sizes[dir]);
+   }
+
+   /* Image is valid once magic is set */
+   atomic_store_explicit (&hdr->magic, PIMAGE_MAGIC, memory_order_release);
+
+   return img;
+}
+
+pimage_t * pimage_open (const char * name)
+{
+   pimage_t * img;
+   struct stat st;
+   void * addr;
+   int fd;
+
+   fd = shm_open (name, O_RDWR, 0);
+   if (fd < 0)
+   {
+      return NULL;
+   }
+
+   if (fstat (fd, &st) != 0 || (size_t)st.st_size < sizeof (pimage_header_t))
+   {
+      close (fd);
+      return NULL;
+   }
+
+   addr = mmap (NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close (fd);
+   if (addr == MAP_FAILED)
+   {
+      return NULL;
+   }
+
+   img = calloc (1, sizeof (*img));
+   if (img == NULL)
+   {
+      munmap (addr, st.st_size);
+      return NULL;
+   }
+
+   img->hdr = addr;
+   img->size = st.st_size;
+
+   if (
+      atomic_load_explicit (&img->hdr->magic, memory_order_acquire) !=
+         PIMAGE_MAGIC ||
+      img->hdr->version != PIMAGE_VERSION ||
+      img->hdr->total_size != img->size)
+   {
+      pimage_close (img);
+      return NULL;
+   }
+
+   return img;
+}
+
+void pimage_close (pimage_t * img)
+{
+   if (img == NULL)
+   {
+      return;
+   }
+
+   munmap (img->hdr, img->size);
+   if (img->name != NULL)
+   {
+      shm_unlink (img->name);
+      free (img->name);
+   }
+   free (img);
+}
+
+const pimage_header_t * pimage_header (const pimage_t * img)
+{
+   return img->hdr;
+}
+
+const pimage_signal_t * pimage_signals (
+   const pimage_t * img,
+   uint32_t * n_signals)
+{
+   *n_signals = img->hdr->n_signals;
+   return (const pimage_signal_t *)((uint8_t *)img->hdr +
+                                    img->hdr->signals_offset);
+}
+
+const pimage_signal_t * pimage_find (const pimage_t * img, const char * name)
+{
+   const pimage_signal_t * signals;
+   uint32_t n_signals;
+   uint32_t i;
+
+   signals = pimage_signals (img, &n_signals);
+   for (i = 0; i < n_signals; i++)
+   {
+      if (strncmp (signals[i].name, name, PIMAGE_NAME_LEN) == 0)
+      {
+         return &signals[i];
+      }
+   }
+
+   return NULL;
+}
+
+const uint8_t * pimage_read_begin (
+   const pimage_t * img,
+   pimage_dir_t dir,
+   uint32_t * token)
+{
+   uint32_t seq;
+
+   seq = atomic_load_explicit (
+      &img->hdr->section[dir].seq,
+      memory_order_acquire);
+   *token = seq & ~1u;
+
+   return bank_ptr (img, dir, seq / 2);
+}
+
+bool pimage_read_end (const pimage_t * img, pimage_dir_t dir, uint32_t token)
+{
+   uint32_t seq;
+
+   atomic_thread_fence (memory_order_acquire);
+   seq = atomic_load_explicit (
+      &img->hdr->section[dir].seq,
+      memory_order_relaxed);
+
+   /* The bank being read is only overwritten once the writer has
+      published the next bank and started on the one after that */
+   return (seq - token) <= 2;
+}
+
+uint32_t pimage_read (const pimage_t * img, pimage_dir_t dir, void * buf)
+{
+   const uint8_t * bank;
+   uint32_t token;
+
+   do
+   {
+      bank = pimage_read_begin (img, dir, &token);
+      memcpy (buf, bank, img->hdr->section[dir].size);
+   } while (!pimage_read_end (img, dir, token));
+
+   return token / 2;
+}
+
+uint8_t * pimage_write_begin (pimage_t * img, pimage_dir_t dir, bool keep)
+{
+   pimage_section_t * section = &img->hdr->section[dir];
+   uint32_t seq;
+   uint8_t * bank;
+
+   seq = atomic_load_explicit (&section->seq, memory_order_relaxed);
+   atomic_store_explicit (&section->seq, seq + 1, memory_order_relaxed);
+   atomic_thread_fence (memory_order_release);
+
+   bank = bank_ptr (img, dir, seq / 2 + 1);
+   if (keep)
+   {
+      memcpy (bank, bank_ptr (img, dir, seq / 2), section->size);
+   }
+
+   return bank;
+}
+
+void pimage_write_end (pimage_t * img, pimage_dir_t dir)
+{
+   pimage_section_t * section = &img->hdr->section[dir];
+   uint32_t seq;
+
+   seq = atomic_load_explicit (&section->seq, memory_order_relaxed);
+   atomic_store_explicit (&section->seq, seq + 1, memory_order_release);
+}
@@ -0,0 +1,205 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/**
+ * Shared-memory process image.
+ *
+ * The sample application exports its inputs and outputs as a binary
+ * image in POSIX shared memory. Each direction is double-buffered and
+ * protected by a sequence counter, so that one writer and any number
+ * of readers can access the signals without locks or copies.
+ *
+ * The application writes the outputs section and reads the inputs
+ * section. An external process does the opposite. Only one process
+ * may write a given section at a time.
+ *
+ * Example (external process):
+ *
+ *    pimage_t * img = pimage_open (PIMAGE_DEFAULT_NAME);
+ *    const pimage_signal_t * in = pimage_find (img, "I8.Input 8 bits");
+ *
+ *    uint8_t * bank = pimage_write_begin (img, PIMAGE_INPUTS, true);
+ *    bank[in->offset] = 0x55;
+ *    bank[in->status_offset] = 0x80;
+ *    pimage_write_end (img, PIMAGE_INPUTS);
+ */
+
+#ifndef PIMAGE_H
+#define PIMAGE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PIMAGE_DEFAULT_NAME "/u-phy-image"
+#define PIMAGE_MAGIC        0x31495055 /* "UPI1" */
+#define PIMAGE_VERSION      1
+#define PIMAGE_NAME_LEN     64
+
+typedef enum pimage_dir
+{
+   PIMAGE_INPUTS = 0,
+   PIMAGE_OUTPUTS = 1,
+} pimage_dir_t;
+
+/**
+ * Signal descriptor. Offsets are relative to the start of a bank.
+ */
+typedef struct pimage_signal
+{
+   char name[PIMAGE_NAME_LEN]; /**< "<slot>.<signal>" */
+   uint32_t offset;            /**< Value offset */
+   uint32_t status_offset;     /**< Status byte offset */
+   uint16_t size;              /**< Value size in bytes */
+   uint8_t dir;                /**< pimage_dir_t */
+   uint8_t reserved;
+} pimage_signal_t;
+
+typedef struct pimage_section
+{
+   /** Incremented once when a write begins and once when it ends.
+       Bank (seq / 2) % 2 holds the latest complete image. */
+   _Atomic uint32_t seq;
+   uint32_t size;    /**< Bank size in bytes */
+   uint32_t bank[2]; /**< Bank offsets from start of image */
+} pimage_section_t;
+
+typedef struct pimage_header
+{
+   _Atomic uint32_t magic; /**< Written last by creator */
+   uint32_t version;
+   uint32_t total_size;
+   uint32_t n_signals;
+   uint32_t signals_offset;
+   pimage_section_t section[2];
+} pimage_header_t;
+
+typedef struct pimage pimage_t;
+
+/**
+ * Create and map a process image. Used by the application. An
+ * existing image with the same name is replaced.
+ *
+ * @param name          shared memory object name
+ * @param signals       signal descriptors
+ * @param n_signals     number of signal descriptors
+ * @param input_size    size of inputs section in bytes
+ * @param output_size   size of outputs section in bytes
+ * @return process image handle, or NULL on failure
+ */
+pimage_t * pimage_create (
+   const char * name,
+   const pimage_signal_t * signals,
+   uint32_t n_signals,
+   uint32_t input_size,
+   uint32_t output_size);
+
+/**
+ * Map an existing process image. Used by external processes.
+ *
+ * @param name          shared memory object name
+ * @return process image handle, or NULL on failure
+ */
+pimage_t * pimage_open (const char * name);
+
+/**
+ * Unmap a process image. The creator also removes the shared memory
+ * object.
+ *
+ * @param img           process image
+ */
+void pimage_close (pimage_t * img);
+
+/**
+ * Get image header, e.g. to iterate over signal descriptors.
+ *
+ * @param img           process image
+ * @return image header
+ */
+const pimage_header_t * pimage_header (const pimage_t * img);
+
+/**
+ * Get signal descriptors.
+ *
+ * @param img           process image
+ * @param n_signals     set to number of signal descriptors
+ * @return array of signal descriptors
+ */
+const pimage_signal_t * pimage_signals (
+   const pimage_t * img,
+   uint32_t * n_signals);
+
+/**
+ * Find signal descriptor by name.
+ *
+ * @param img           process image
+ * @param name          "<slot>.<signal>"
+ * @return signal descriptor, or NULL if not found
+ */
+const pimage_signal_t * pimage_find (const pimage_t * img, const char * name);
+
+/**
+ * Start zero-copy read of the latest complete bank.
+ *
+ * @param img           process image
+ * @param dir           section
+ * @param token         set to token for pimage_read_end()
+ * @return pointer to bank
+ */
+const uint8_t * pimage_read_begin (
+   const pimage_t * img,
+   pimage_dir_t dir,
+   uint32_t * token);
+
+/**
+ * Finish zero-copy read.
+ *
+ * @param img           process image
+ * @param dir           section
+ * @param token         token from pimage_read_begin()
+ * @return true if the bank was not modified during the read, false
+ *         if the data must be discarded and the read retried
+ */
+bool pimage_read_end (const pimage_t * img, pimage_dir_t dir, uint32_t token);
+
+/**
+ * Copy a consistent snapshot of a section.
+ *
+ * @param img           process image
+ * @param dir           section
+ * @param buf           destination, at least section size bytes
+ * @return sequence number of the snapshot
+ */
+uint32_t pimage_read (const pimage_t * img, pimage_dir_t dir, void * buf);
+
+/**
+ * Start write of a section. The returned bank is not visible to
+ * readers until pimage_write_end() is called.
+ *
+ * @param img           process image
+ * @param dir           section
+ * @param keep          initialise bank with latest complete image,
+ *                      for writers that only update some signals
+ * @return pointer to bank
+ */
+uint8_t * pimage_write_begin (pimage_t * img, pimage_dir_t dir, bool keep);
+
+/**
+ * Publish the bank returned by pimage_write_begin().
+ *
+ * @param img           process image
+ * @param dir           section
+ */
+void pimage_write_end (pimage_t * img, pimage_dir_t dir);
+
+#endif /* PIMAGE_H */
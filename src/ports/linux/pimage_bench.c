@@ -0,0 +1,181 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Compare the cost of one application cycle using the text file I/O
+ * path (render status file, parse input file) with the shared-memory
+ * process image (publish outputs, read inputs).
+ *
+ * Usage: pimage-bench [signals] [cycles]
+ */
+
+#include "pimage.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_NAME        "/u-phy-image-bench"
+#define BENCH_STATUS_FILE "/tmp/u-phy-bench-status.txt"
+#define BENCH_INPUT_FILE  "/tmp/u-phy-bench-input.txt"
+
+static uint64_t now_ns (void)
+{
+   struct timespec ts;
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static int file_cycle (
+   const pimage_signal_t * signals,
+   uint32_t n,
+   uint8_t * values)
+{
+   FILE * f;
+   char name[PIMAGE_NAME_LEN];
+   unsigned int value;
+   unsigned int status;
+   uint32_t i;
+
+   /* Render outputs, as the status file does */
+   f = fopen (BENCH_STATUS_FILE, "w");
+   if (f == NULL)
+   {
+      return -1;
+   }
+   for (i = 0; i < n; i++)
+   {
+      fprintf (f, "%s %u 0x%02x\n", signals[i].name, values[i], 0x80);
+   }
+   fclose (f);
+
+   /* Parse inputs, as the input file does */
+   f = fopen (BENCH_INPUT_FILE, "r");
+   if (f == NULL)
+   {
+      return -1;
+   }
+   for (i = 0; i < n; i++)
+   {
+      if (fscanf (f, "%63s %u %x", name, &value, &status) != 3)
+      {
+         break;
+      }
+      values[i] = (uint8_t)value;
+   }
+   fclose (f);
+
+   return 0;
+}
+
+static void shm_cycle (pimage_t * img, uint32_t n, uint8_t * values)
+{
+   uint8_t * bank;
+
+   bank = pimage_write_begin (img, PIMAGE_OUTPUTS, false);
+   memcpy (bank, values, n);
+   memset (bank + n, 0x80, n);
+   pimage_write_end (img, PIMAGE_OUTPUTS);
+
+   pimage_read (img, PIMAGE_INPUTS, values);
+}
+
+int main (int argc, char * argv[])
+{
+   uint32_t n = (argc > 1) ? strtoul (argv[1], NULL, 0) : 64;
+   uint32_t cycles = (argc > 2) ? strtoul (argv[2], NULL, 0) : 10000;
+   pimage_signal_t * signals;
+   uint8_t * values;
+   pimage_t * img;
+   uint64_t t0;
+   uint64_t file_ns;
+   uint64_t shm_ns;
+   FILE * f;
+   uint32_t i;
+
+   if (cycles == 0)
+   {
+      printf ("Usage: pimage-bench [signals] [cycles], cycles > 0\n");
+      return EXIT_FAILURE;
+   }
+
+   signals = calloc (n, sizeof (*signals));
+   values = calloc (2 * n, 1);
+   if (signals == NULL || values == NULL)
+   {
+      return EXIT_FAILURE;
+   }
+
+   for (i = 0; i < n; i++)
+   {
+      snprintf (
+         signals[i].name,
+         sizeof (signals[i].name),
+         "S%" PRIu32 ".Signal",
+         i);
+      signals[i].offset = i;
+      signals[i].status_offset = n + i;
+      signals[i].size = 1;
+      signals[i].dir = PIMAGE_OUTPUTS;
+   }
+
+   f = fopen (BENCH_INPUT_FILE, "w");
+   if (f == NULL)
+   {
+      return EXIT_FAILURE;
+   }
+   for (i = 0; i < n; i++)
+   {
+      fprintf (f, "%s %u 0x80\n", signals[i].name, i & 0xFF);
+   }
+   fclose (f);
+
+   img = pimage_create (BENCH_NAME, signals, n, 2 * n, 2 * n);
+   if (img == NULL)
+   {
+      printf ("Failed to create process image\n");
+      return EXIT_FAILURE;
+   }
+
+   t0 = now_ns();
+   for (i = 0; i < cycles; i++)
+   {
+      if (file_cycle (signals, n, values) != 0)
+      {
+         printf ("Failed to open bench files\n");
+         return EXIT_FAILURE;
+      }
+   }
+   file_ns = now_ns() - t0;
+
+   t0 = now_ns();
+   for (i = 0; i < cycles; i++)
+   {
+      shm_cycle (img, n, values);
+   }
+   shm_ns = now_ns() - t0;
+
+   printf ("signals: %" PRIu32 "\n", n);
+   printf ("cycles: %" PRIu32 "\n", cycles);
+   printf ("file ns/cycle: %" PRIu64 "\n", file_ns / cycles);
+   printf ("shm ns/cycle: %" PRIu64 "\n", shm_ns / cycles);
+
+   pimage_close (img);
+   remove (BENCH_STATUS_FILE);
+   remove (BENCH_INPUT_FILE);
+   free (values);
+   free (signals);
+
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+#define _GNU_SOURCE /* CPU affinity */
+
+#include "rt.h"
+
+#include <alloca.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define RT_STACK_PREFAULT (256 * 1024)
+#define RT_HEAP_PREFAULT  (4 * 1024 * 1024)
+
+int rt_parse_args (rt_cfg_t * cfg, int argc, char * argv[])
+{
+   int opt;
+
+   cfg->priority = 0;
+   cfg->cpu = -1;
+   cfg->stack_prefault = RT_STACK_PREFAULT;
+   cfg->heap_prefault = RT_HEAP_PREFAULT;
+   cfg->idle_ms = -1;
+
+   while ((opt = getopt (argc, argv, "+" RT_OPTIONS)) != -1)
+   {
+      switch (opt)
+      {
+      case 'r':
+         cfg->priority = atoi (optarg);
+         if (
+            cfg->priority < sched_get_priority_min (SCHED_FIFO) ||
+            cfg->priority > sched_get_priority_max (SCHED_FIFO))
+         {
+            return -1;
+         }
+         break;
+      case 'c':
+         cfg->cpu = atoi (optarg);
+         if (cfg->cpu < 0)
+         {
+            return -1;
+         }
+         break;
+      case 'i':
+         cfg->idle_ms = atoi (optarg);
+         if (cfg->idle_ms < 0)
+         {
+            return -1;
+         }
+         break;
+      default:
+         return -1;
+      }
+   }
+
+   return optind;
+}
+
+bool rt_enabled (const rt_cfg_t * cfg)
+{
+   return cfg->priority > 0 || cfg->cpu >= 0;
+}
+
+static void __attribute__ ((noinline)) prefault_stack (size_t size)
+{
+   volatile unsigned char * stack = alloca (size);
+   size_t page = sysconf (_SC_PAGESIZE);
+   size_t i;
+
+   for (i = 0; i < size; i += page)
+   {
+      stack[i] = 0;
+   }
+}
+
+static int prefault_heap (size_t size)
+{
+   unsigned char * heap;
+   size_t page = sysconf (_SC_PAGESIZE);
+   size_t i;
+
+   /* Keep freed memory in the heap and serve all allocations from
+      it, so that prefaulted pages are reused */
+   mallopt (M_TRIM_THRESHOLD, -1);
+   mallopt (M_MMAP_MAX, 0);
+
+   heap = malloc (size);
+   if (heap == NULL)
+   {
+      return -1;
+   }
+
+   for (i = 0; i < size; i += page)
+   {
+      heap[i] = 0;
+   }
+
+   free (heap);
+   return 0;
+}
+
+int rt_apply (const rt_cfg_t * cfg)
+{
+   struct sched_param param;
+   cpu_set_t cpus;
+   int error;
+
+   if (cfg->cpu >= 0)
+   {
+      CPU_ZERO (&cpus);
+      CPU_SET (cfg->cpu, &cpus);
+      error = pthread_setaffinity_np (pthread_self(), sizeof (cpus), &cpus);
+      if (error != 0)
+      {
+         printf ("Failed to set CPU affinity: %s\n", strerror (error));
+         return -1;
+      }
+   }
+
+   if (cfg->priority > 0)
+   {
+      if (mlockall (MCL_CURRENT | MCL_FUTURE) != 0)
+      {
+         printf ("Failed to lock memory\n");
+         return -1;
+      }
+
+      if (prefault_heap (cfg->heap_prefault) != 0)
+      {
+         printf ("Failed to prefault heap\n");
+         return -1;
+      }
+      prefault_stack (cfg->stack_prefault);
+
+      memset (&param, 0, sizeof (param));
+      param.sched_priority = cfg->priority;
+      error = pthread_setschedparam (pthread_self(), SCHED_FIFO, &param);
+      if (error != 0)
+      {
+         printf ("Failed to set SCHED_FIFO priority: %s\n", strerror (error));
+         return -1;
+      }
+   }
+
+   printf (
+      "Real-time profile: priority %d, cpu %d\n",
+      cfg->priority,
+      cfg->cpu);
+
+   return 0;
+}
@@ -0,0 +1,74 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/**
+ * Real-time execution profile for the Linux ports.
+ *
+ * Selected from the command line. Applies SCHED_FIFO priority, CPU
+ * affinity, locks all current and future memory and prefaults stack
+ * and heap, so that the cyclic path does not take page faults.
+ * Settings are applied to the calling thread and inherited by all
+ * threads it creates later.
+ */
+
+#ifndef RT_H
+#define RT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define RT_OPTIONS "r:c:i:"
+
+#define RT_HELP                                                                \
+   "\nOptions:\n"                                                              \
+   "  -r <priority>  run with SCHED_FIFO priority (1-99), locked and\n"        \
+   "                 prefaulted memory\n"                                      \
+   "  -c <cpu>       pin to CPU\n"                                             \
+   "  -i <ms>        block up to <ms> when idle instead of busy polling,\n"    \
+   "                 events may then be handled up to <ms> late\n"
+
+typedef struct rt_cfg
+{
+   int priority; /**< SCHED_FIFO priority, 0 to keep default scheduling */
+   int cpu;      /**< CPU to pin to, -1 for no affinity */
+   size_t stack_prefault; /**< Stack bytes to prefault */
+   size_t heap_prefault;  /**< Heap bytes to prefault and retain */
+   int idle_ms; /**< Worker idle time, -1 for build default */
+} rt_cfg_t;
+
+/**
+ * Parse real-time options from the command line.
+ *
+ * @param cfg           set to parsed configuration
+ * @param argc          argument count
+ * @param argv          arguments
+ * @return index of first non-option argument, or -1 on error
+ */
+int rt_parse_args (rt_cfg_t * cfg, int argc, char * argv[]);
+
+/**
+ * Apply real-time profile to the calling thread and process.
+ *
+ * @param cfg           configuration
+ * @return 0 on success, -1 on failure
+ */
+int rt_apply (const rt_cfg_t * cfg);
+
+/**
+ * Check if a real-time profile is selected.
+ *
+ * @param cfg           configuration
+ * @return true if any real-time setting is enabled
+ */
+bool rt_enabled (const rt_cfg_t * cfg);
+
+#endif /* RT_H */
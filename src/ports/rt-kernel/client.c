@@ -11,6 +11,7 @@
  ********************************************************************/
 
 #include "application.h"
+#include "app_eeprom.h"
 #include "options.h"
 #include "up_api.h"
 #include "up_util.h"
@@ -31,6 +32,7 @@
 void shield_event_isr (void * arg)
 {
    up_event_ind();
+   app_worker_wake();
 }
 #endif
 
@@ -56,17 +58,7 @@ static void main_entry (void * arg)
 #if defined (UP_DEVICE_ETHERCAT_SUPPORTED)
       if (app_cfg.device->bustype == UP_BUSTYPE_ECAT)
       {
-         /* Start and end tags for the generated EtherCAT SII eeprom.
-          * Defined in eeprom.S.
-          */
-         extern const uint8_t _eeprom_bin_start;
-         extern const uint8_t _eeprom_bin_end;
-
-         if (
-            up_write_ecat_eeprom (
-               up,
-               &_eeprom_bin_start,
-               &_eeprom_bin_end - &_eeprom_bin_start) != 0)
+         if (app_eeprom_write (up) != 0)
          {
             printf ("Failed to write EtherCAT eeprom \n");
             return;
@@ -87,6 +79,8 @@ static void main_entry (void * arg)
    }
 }
 
+static char transport_name[64];
+
 static int _cmd_start (int argc, char * argv[])
 {
    up_t * up;
@@ -103,6 +97,10 @@ static int _cmd_start (int argc, char * argv[])
       return -1;
    }
 
+   /* Keep name of transport for statistics */
+   snprintf (transport_name, sizeof (transport_name), "%s", argv[1]);
+   app_set_transport (transport_name);
+
    scheme = strtok_r (argv[1], ":", &saveptr);
    if (scheme == NULL)
    {
@@ -261,6 +259,27 @@ static const shell_cmd_t cmd_start = {
 
 SHELL_CMD (cmd_start);
 
+static int _cmd_transport (int argc, char * argv[])
+{
+   app_request_transport_stats();
+   return 0;
+}
+
+static const shell_cmd_t cmd_transport = {
+   .cmd = _cmd_transport,
+   .name = "up_transport",
+   .help_short = "show u-phy transport statistics",
+   .help_long =
+      "Show u-phy transport statistics\n"
+      "Usage: up_transport\n"
+      "\n"
+      "Shows calls, errors, application data bytes and round-trip\n"
+      "times per operation, and the number of reconnects. Statistics\n"
+      "are printed by the application task on its next cycle.\n"
+};
+
+SHELL_CMD (cmd_transport);
+
 int main (int argc, char * argv[])
 {
 }
@@ -11,6 +11,7 @@
  ********************************************************************/
 
 #include "application.h"
+#include "app_eeprom.h"
 #include "options.h"
 #include "up_api.h"
 #include "up_util.h"
@@ -47,17 +48,7 @@ static void main_entry (void * arg)
 #if defined (UP_DEVICE_ETHERCAT_SUPPORTED)
       if (app_cfg.device->bustype == UP_BUSTYPE_ECAT)
       {
-         /* Start and end tags for the generated EtherCAT SII eeprom.
-          * Defined in eeprom.S.
-          */
-         extern const uint8_t _eeprom_bin_start;
-         extern const uint8_t _eeprom_bin_end;
-
-         if (
-            up_write_ecat_eeprom (
-               up,
-               &_eeprom_bin_start,
-               &_eeprom_bin_end - &_eeprom_bin_start) != 0)
+         if (app_eeprom_write (up) != 0)
          {
             printf ("Failed to write EtherCAT eeprom \n");
             return;
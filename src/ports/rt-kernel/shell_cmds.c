@@ -0,0 +1,59 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * http://www.rt-labs.com
+ * Copyright 2024 rt-labs AB, Sweden.
+ * See LICENSE file in the project root for full license information.
+ ********************************************************************/
+
+/*
+ * Shell commands shared by the rt-kernel ports.
+ */
+
+#include "application.h"
+
+#include "shell.h"
+
+static int _cmd_stats (int argc, char * argv[])
+{
+   app_request_stats();
+   return 0;
+}
+
+static const shell_cmd_t cmd_stats = {
+   .cmd = _cmd_stats,
+   .name = "up_stats",
+   .help_short = "show u-phy application statistics",
+   .help_long =
+      "Show u-phy application statistics\n"
+      "Usage: up_stats\n"
+      "\n"
+      "Statistics are printed by the application task on its\n"
+      "next cycle.\n"
+};
+
+SHELL_CMD (cmd_stats);
+
+static int _cmd_dump (int argc, char * argv[])
+{
+   app_request_recorder_dump();
+   return 0;
+}
+
+static const shell_cmd_t cmd_dump = {
+   .cmd = _cmd_dump,
+   .name = "up_dump",
+   .help_short = "dump u-phy flight recorder",
+   .help_long =
+      "Dump u-phy flight recorder\n"
+      "Usage: up_dump\n"
+      "\n"
+      "Writes the recorded process data and events to file. The\n"
+      "file is written by the application task on its next cycle.\n"
+};
+
+SHELL_CMD (cmd_dump);
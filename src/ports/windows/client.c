@@ -50,6 +50,8 @@ static void main_entry (up_t * up)
    }
 }
 
+static char transport_name[64];
+
 static int _cmd_start (int argc, char * argv[])
 {
    up_t * up;
@@ -65,6 +67,10 @@ static int _cmd_start (int argc, char * argv[])
       return -1;
    }
 
+   /* Keep name of transport for statistics */
+   snprintf (transport_name, sizeof (transport_name), "%s", argv[1]);
+   app_set_transport (transport_name);
+
    scheme = strtok_r (argv[1], ":", &saveptr);
    if (scheme == NULL)
       return -1;
@@ -155,6 +161,9 @@ static int _cmd_start (int argc, char * argv[])
       exit (EXIT_FAILURE);
    }
 
+   /* Print statistics when the application exits */
+   atexit (app_show_stats);
+
    main_entry (up);
 
    return 0;
@@ -99,6 +99,9 @@ static int _cmd_start (int argc, char * argv[])
    printf ("Starting sample application\n");
    up = up_init (&app_cfg);
 
+   /* Print statistics when the application exits */
+   atexit (app_show_stats);
+
    main_entry (up);
 
    return 0;
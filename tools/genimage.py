@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+#********************************************************************
+#        _       _         _
+#  _ __ | |_  _ | |  __ _ | |__   ___
+# | '__|| __|(_)| | / _` || '_ \ / __|
+# | |   | |_  _ | || (_| || |_) |\__ \
+# |_|    \__|(_)|_| \__,_||_.__/ |___/
+#
+# www.rt-labs.com
+# Copyright 2024 rt-labs AB, Sweden.
+# See LICENSE file in the project root for full license information.
+#*******************************************************************/
+
+"""Generate a packed process image layout for a U-Phy model.
+
+The layout is emitted as a C header with one struct for the inputs
+and one for the outputs. Values are stored naturally aligned in slot
+and signal order from offset 0, followed by one status byte per
+signal. This is the layout built at runtime by app_image_init(), so a
+section packed by app_image_pack() can be accessed through the
+generated structs and moved as a single block of UP_IMAGE_*_SIZE
+bytes. The header also has inline functions that pack and unpack each
+section with compile-time offsets and sizes.
+
+Datatypes other than the scalar types below have no size in the
+model. No layout is generated for such models; the header then only
+defines UP_IMAGE_AVAILABLE as 0.
+
+Example:
+  genimage.py models/digio.json -o generated/model_image.h
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+CTYPES = {
+    "INT8": ("int8_t", 1),
+    "INT16": ("int16_t", 2),
+    "INT32": ("int32_t", 4),
+    "UINT8": ("uint8_t", 1),
+    "UINT16": ("uint16_t", 2),
+    "UINT32": ("uint32_t", 4),
+    "REAL32": ("float", 4),
+}
+
+
+def c_name(*parts):
+    name = "_".join(re.sub(r"\W", "_", p) for p in parts)
+    return re.sub(r"_+", "_", name).strip("_")
+
+
+class UnsupportedDatatype(Exception):
+    pass
+
+
+def section_layout(model, kind):
+    """Get list of (member, description, ctype, size, offset, ix) and
+    the offset of the status array for a section. ix is the index in
+    up_vars, assigned in slot order with the inputs, outputs and
+    parameters of each slot in turn, as done by upgen."""
+    modules = {m["id"]: m for m in model["modules"]}
+    signals = []
+    names = set()
+    offset = 0
+    ix = 0
+
+    for slot in model["devices"][0]["slots"]:
+        module = modules[slot["module"]]
+        if kind == "outputs":
+            ix += len(module.get("inputs", []))
+        for signal in module.get(kind, []):
+            datatype = signal["datatype"]
+            if datatype not in CTYPES:
+                raise UnsupportedDatatype(
+                    "%s.%s: unsupported datatype %s"
+                    % (slot["name"], signal["name"], datatype)
+                )
+            ctype, size = CTYPES[datatype]
+            offset = (offset + size - 1) & ~(size - 1)
+
+            member = c_name(slot["name"], signal["name"])
+            if member in names or member == "status":
+                member = "%s_%d" % (member, len(signals))
+            names.add(member)
+
+            signals.append(
+                (
+                    member,
+                    "%s.%s" % (slot["name"], signal["name"]),
+                    ctype,
+                    size,
+                    offset,
+                    ix,
+                )
+            )
+            offset += size
+            ix += 1
+        if kind == "inputs":
+            ix += len(module.get("outputs", []))
+        ix += len(module.get("parameters", []))
+
+    return signals, offset
+
+
+def emit_section(out, prefix, tag, signals, status_offset):
+    n = len(signals)
+    size = status_offset + n
+
+    out.append("typedef struct up_image_%s" % tag)
+    out.append("{")
+    for member, desc, ctype, _, _, _ in signals:
+        out.append("   %s %s; /* %s */" % (ctype, member, desc))
+    out.append("   uint8_t status[%d];" % (n if n > 0 else 1))
+    out.append("} up_image_%s_t;" % tag)
+    out.append("")
+    for name, value in (("SIZE", size), ("STATUS_OFFSET", status_offset), ("COUNT", n)):
+        out.append("#define %-32s %d" % ("UP_IMAGE_%s_%s" % (prefix, name), value))
+    out.append("")
+    out.append("/* Value offsets and up_vars indices in signal order, e.g. for")
+    out.append("   layout checks */")
+    offsets = ", ".join(str(s[4]) for s in signals) or "0"
+    out.append("#define UP_IMAGE_%s_OFFSETS {%s}" % (prefix, offsets))
+    indices = ", ".join(str(s[5]) for s in signals) or "0"
+    out.append("#define UP_IMAGE_%s_INDICES {%s}" % (prefix, indices))
+    out.append("")
+    for member, _, _, _, offset, _ in signals:
+        out.append(
+            "_Static_assert (offsetof (up_image_%s_t, %s) == %d, \"layout\");"
+            % (tag, member, offset)
+        )
+    out.append(
+        "_Static_assert (offsetof (up_image_%s_t, status) == %d, \"layout\");"
+        % (tag, status_offset)
+    )
+    out.append("")
+
+    out.append("static inline void up_image_%s_pack (" % tag)
+    out.append("   up_image_%s_t * image," % tag)
+    out.append("   const up_signal_info_t * vars)")
+    out.append("{")
+    for i, (member, _, _, size, _, ix) in enumerate(signals):
+        out.append("   memcpy (&image->%s, vars[%d].value, %d);" % (member, ix, size))
+        out.append("   image->status[%d] = *vars[%d].status;" % (i, ix))
+    if n == 0:
+        out.append("   (void)image;")
+        out.append("   (void)vars;")
+    out.append("}")
+    out.append("")
+
+    out.append("static inline void up_image_%s_unpack (" % tag)
+    out.append("   const up_image_%s_t * image," % tag)
+    out.append("   up_signal_info_t * vars)")
+    out.append("{")
+    for i, (member, _, _, size, _, ix) in enumerate(signals):
+        out.append("   memcpy (vars[%d].value, &image->%s, %d);" % (ix, member, size))
+        out.append("   *vars[%d].status = image->status[%d];" % (ix, i))
+    if n == 0:
+        out.append("   (void)image;")
+        out.append("   (void)vars;")
+    out.append("}")
+    out.append("")
+
+
+def generate(model, source):
+    out = [
+        "/* Generated by genimage.py from %s. Do not edit. */" % source,
+        "",
+        "#ifndef MODEL_IMAGE_H",
+        "#define MODEL_IMAGE_H",
+        "",
+    ]
+
+    try:
+        inputs, inputs_status = section_layout(model, "inputs")
+        outputs, outputs_status = section_layout(model, "outputs")
+    except UnsupportedDatatype as e:
+        print("genimage.py: %s, no layout generated" % e, file=sys.stderr)
+        out.append("/* No layout, %s */" % e)
+        out.append("#define UP_IMAGE_AVAILABLE 0")
+        out.append("")
+        out.append("#endif /* MODEL_IMAGE_H */")
+        return "\n".join(out) + "\n"
+
+    out.extend(
+        [
+            '#include "up_api.h"',
+            "",
+            "#include <stddef.h>",
+            "#include <stdint.h>",
+            "#include <string.h>",
+            "",
+            "#define UP_IMAGE_AVAILABLE 1",
+            "",
+        ]
+    )
+    emit_section(out, "INPUTS", "inputs", inputs, inputs_status)
+    emit_section(out, "OUTPUTS", "outputs", outputs, outputs_status)
+    out.append("#endif /* MODEL_IMAGE_H */")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+    )
+    parser.add_argument("model", help="U-Phy model (JSON)")
+    parser.add_argument("-o", "--output", required=True)
+    args = parser.parse_args()
+
+    with open(args.model) as f:
+        model = json.load(f)
+
+    header = generate(model, os.path.basename(args.model))
+
+    # Keep timestamp if unchanged, to avoid needless rebuilds
+    try:
+        with open(args.output) as f:
+            if f.read() == header:
+                return
+    except OSError:
+        pass
+
+    with open(args.output, "w") as f:
+        f.write(header)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+#********************************************************************
+#        _       _         _
+#  _ __ | |_  _ | |  __ _ | |__   ___
+# | '__|| __|(_)| | / _` || '_ \ / __|
+# | |   | |_  _ | || (_| || |_) |\__ \
+# |_|    \__|(_)|_| \__,_||_.__/ |___/
+#
+# www.rt-labs.com
+# Copyright 2024 rt-labs AB, Sweden.
+# See LICENSE file in the project root for full license information.
+#*******************************************************************/
+
+"""Generate flat lookup tables for a U-Phy model.
+
+The tables map (slot, parameter) to the index in up_vars, value size,
+datatype, and the range and persistence from the model. The tables
+are emitted as const data in a C source file, see src/app_lookup.h
+for the types.
+
+up_vars indices are assigned in slot order with the inputs, outputs
+and parameters of each slot in turn, as done by upgen.
+
+Example:
+  genlookup.py models/digio.json -o generated/model_lookup.c
+"""
+
+import argparse
+import json
+import math
+import os
+import struct
+import sys
+
+from genimage import CTYPES
+
+LIMITS = {
+    "INT8": (-(2**7), 2**7 - 1),
+    "INT16": (-(2**15), 2**15 - 1),
+    "INT32": (-(2**31), 2**31 - 1),
+    "UINT8": (0, 2**8 - 1),
+    "UINT16": (0, 2**16 - 1),
+    "UINT32": (0, 2**32 - 1),
+}
+
+
+def c_limit(datatype, value, where):
+    """Get C initialiser for an app_lookup_limit_t."""
+    if datatype == "REAL32":
+        # Round to the nearest float, as the value is compared as float
+        f = struct.unpack("<f", struct.pack("<f", float(value)))[0]
+        if math.isinf(f):
+            return "{.f = %sINFINITY}" % ("-" if f < 0 else "")
+        return "{.f = %r}" % f
+
+    v = value.strip()
+    v = int(v, 16) if v.lower().lstrip("-").startswith("0x") else int(v)
+    lo, hi = LIMITS[datatype]
+    if not lo <= v <= hi:
+        raise SystemExit("%s: %s out of range for %s" % (where, value, datatype))
+    if datatype.startswith("INT"):
+        return "{.i = %d}" % v
+    return "{.u = %du}" % v
+
+
+def param_entry(slot, param, ix):
+    where = "%s.%s" % (slot["name"], param["name"])
+    datatype = param["datatype"]
+    if datatype not in CTYPES:
+        # Size unknown, an invalid entry makes app_lookup_check() reject
+        # the tables so that the device model is used instead
+        print(
+            "genlookup.py: %s: unsupported datatype %s, tables not usable"
+            % (where, datatype),
+            file=sys.stderr,
+        )
+        return (
+            "   {.ix = %d, .size = 0, .datatype = 0xFF, .flags = 0}, "
+            "/* %s, unsupported datatype %s */" % (ix, where, datatype)
+        )
+
+    flags = []
+    lo = hi = "{0}"
+    if "min" in param or "max" in param:
+        flags.append("APP_LOOKUP_RANGE")
+        if datatype == "REAL32":
+            default_lo, default_hi = "-inf", "inf"
+        else:
+            default_lo, default_hi = (str(x) for x in LIMITS[datatype])
+        lo = c_limit(datatype, param.get("min", default_lo), where)
+        hi = c_limit(datatype, param.get("max", default_hi), where)
+    if param.get("persistent"):
+        flags.append("APP_LOOKUP_PERSISTENT")
+
+    return (
+        "   {.ix = %d, .size = %d, .datatype = UP_DTYPE_%s, .flags = %s, "
+        ".min = %s, .max = %s}, /* %s */"
+        % (
+            ix,
+            CTYPES[datatype][1],
+            datatype,
+            " | ".join(flags) or "0",
+            lo,
+            hi,
+            where,
+        )
+    )
+
+
+def emit_table(out, ctype, name, entries):
+    out.append("static const %s %s[] = {" % (ctype, name))
+    out.extend(entries or ["   {0},"])
+    out.append("};")
+    out.append("")
+
+
+def emit_base(out, name, base):
+    out.append("static const uint16_t %s[] = {%s};" % (name, ", ".join(map(str, base))))
+    out.append("")
+
+
+def generate(model, source):
+    modules = {m["id"]: m for m in model["modules"]}
+    slots = model["devices"][0]["slots"]
+
+    params = []
+    param_base = [0]
+    ix = 0
+
+    for slot in slots:
+        module = modules[slot["module"]]
+
+        # Inputs and outputs precede the parameters of each slot
+        ix += len(module.get("inputs", [])) + len(module.get("outputs", []))
+        for param in module.get("parameters", []):
+            params.append(param_entry(slot, param, ix))
+            ix += 1
+
+        param_base.append(len(params))
+
+    out = [
+        "/* Generated by genlookup.py from %s. Do not edit. */" % source,
+        "",
+        '#include "app_lookup.h"',
+        "",
+        "#include <math.h>",
+        "",
+    ]
+    emit_base(out, "param_base", param_base)
+    emit_table(out, "app_lookup_param_t", "params", params)
+    out.extend(
+        [
+            "const app_lookup_t model_lookup = {",
+            "   .n_slots = %d," % len(slots),
+            "   .param_base = param_base,",
+            "   .params = params,",
+            "};",
+        ]
+    )
+    return "\n".join(out) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+    )
+    parser.add_argument("model", help="U-Phy model (JSON)")
+    parser.add_argument("-o", "--output", required=True)
+    args = parser.parse_args()
+
+    with open(args.model) as f:
+        model = json.load(f)
+
+    source = generate(model, os.path.basename(args.model))
+
+    # Keep timestamp if unchanged, to avoid needless rebuilds
+    try:
+        with open(args.output) as f:
+            if f.read() == source:
+                return
+    except OSError:
+        pass
+
+    with open(args.output, "w") as f:
+        f.write(source)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+#********************************************************************
+#        _       _         _
+#  _ __ | |_  _ | |  __ _ | |__   ___
+# | '__|| __|(_)| | / _` || '_ \ / __|
+# | |   | |_  _ | || (_| || |_) |\__ \
+# |_|    \__|(_)|_| \__,_||_.__/ |___/
+#
+# www.rt-labs.com
+# Copyright 2024 rt-labs AB, Sweden.
+# See LICENSE file in the project root for full license information.
+#*******************************************************************/
+
+"""Generate synthetic U-Phy models for scaling tests.
+
+The generated model has the same structure as models/digio.json but
+with a configurable number of slots, signals, parameters and alarms
+of mixed datatypes. Output is deterministic for a given set of
+arguments.
+
+Large models are intended for the mock fieldbus. They may exceed the
+process data limits of real fieldbuses.
+
+Example:
+  genmodel.py --slots 200 --inputs 8 --outputs 8 --params 4 \\
+              --alarms 2 -o large.json
+"""
+
+import argparse
+import json
+import uuid
+
+DATATYPES = ["UINT8", "UINT16", "UINT32", "INT8", "INT16", "INT32", "REAL32"]
+
+NAMESPACE = uuid.UUID("6c1b0a8e-4f55-4a43-9d0b-2b6f1f0d7e10")
+
+
+def make_id(*parts):
+    return str(uuid.uuid5(NAMESPACE, "/".join(str(p) for p in parts)))
+
+
+def make_signal(module, kind, ix, datatype):
+    return {
+        "name": f"{kind} {ix}",
+        "id": make_id(module, kind, ix),
+        "datatype": datatype,
+        "description": f"Synthetic {kind.lower()} {ix}",
+    }
+
+
+def make_param(module, ix, datatype):
+    return {
+        "name": f"Parameter {ix}",
+        "id": make_id(module, "Parameter", ix),
+        "description": f"Synthetic parameter {ix}",
+        "datatype": datatype,
+        "default": "1",
+        "min": "0",
+        "max": "100",
+        "permissions": "RW",
+        "persistent": False,
+        "derived": True,
+        "profinet": {"index": str(100 + ix)},
+    }
+
+
+def make_alarm(module, ix):
+    code = 400 + ix
+    return {
+        "name": f"Alarm {code}",
+        "message": f"Alarm message {code}",
+        "id": make_id(module, "Alarm", ix),
+        "error_code": str(code),
+    }
+
+
+def make_module(args, m):
+    name = f"M{m}"
+    types = args.datatypes
+
+    def dtype(kind, ix):
+        return types[(m + ix + kind) % len(types)]
+
+    module = {
+        "name": name,
+        "id": make_id(name),
+        "description": f"Synthetic module {m}",
+    }
+
+    if args.inputs:
+        module["inputs"] = [
+            make_signal(name, "Input", i, dtype(0, i)) for i in range(args.inputs)
+        ]
+    if args.outputs:
+        module["outputs"] = [
+            make_signal(name, "Output", i, dtype(1, i)) for i in range(args.outputs)
+        ]
+    if args.params:
+        module["parameters"] = [
+            make_param(name, i, dtype(2, i)) for i in range(args.params)
+        ]
+    if args.alarms:
+        module["alarms"] = [make_alarm(name, i) for i in range(args.alarms)]
+
+    module["profinet"] = {
+        "module_id": hex(0x1000 + m),
+        "submodule_id": hex(0x1001 + m),
+    }
+
+    return module
+
+
+def make_model(args):
+    n_modules = min(args.modules or args.slots, args.slots)
+    modules = [make_module(args, m) for m in range(n_modules)]
+    slots = [
+        {"name": f"S{s}", "module": modules[s % n_modules]["id"]}
+        for s in range(args.slots)
+    ]
+
+    device = {
+        "name": args.name,
+        "id": make_id(args.name, args.slots, args.inputs, args.outputs),
+        "description": "Synthetic U-Phy device for scaling tests.",
+        "hardware_release": "V0.8.0",
+        "software_release": "V0.5.0",
+        "serial": "1234",
+        "loglevel": "INFO",
+        "webgui_enable": False,
+        "slots": slots,
+        "ethercat": {"product_code": "#x1002", "revision": "1", "profile": "5001"},
+        "profinet": {
+            "dap_module_id": "1",
+            "profile_id": "0x0",
+            "profile_specific_type": "0x0",
+            "min_device_interval": "32",
+            "default_stationname": "u-phy-synthetic",
+            "order_id": "SYN01",
+            "hw_revision": "1",
+            "sw_revision_prefix": "V",
+            "sw_revision_functional_enhancement": "0",
+            "sw_revision_bug_fix": "1",
+            "sw_revision_internal_change": "27",
+            "revision_counter": "0",
+            "main_family": "I/O",
+            "product_family": "U-Phy Samples",
+        },
+        "ethernetip": {
+            "revision": "1.1",
+            "product_code": "11",
+            "home_url": "https://rt-labs.com/u-phy/",
+            "create_date": "09-06-2023",
+            "create_time": "13:04:42",
+            "modification_date": "09-06-2023",
+            "modification_time": "13:04:42",
+            "min_data_interval": "2000",
+            "default_data_interval": "4000",
+        },
+        "modbus": {"port": "502"},
+        "cclink": {"model_code": "0x1235", "equipment_ver": "0x0001"},
+    }
+
+    return {
+        "name": args.name,
+        "vendor": "RT-Labs AB",
+        "devices": [device],
+        "modules": modules,
+        "ethercat": {"vendor_id": "#x1337", "group": "U-Phy"},
+        "profinet": {"vendor_id": "0x0493", "device_id": "0x0004"},
+        "ethernetip": {"vendor_id": "1772"},
+        "cclink": {"vendor_code": "0x1067"},
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+    )
+    parser.add_argument("--name", default="U-Phy Synthetic Sample")
+    parser.add_argument("--slots", type=int, default=100)
+    parser.add_argument(
+        "--modules", type=int, default=0, help="distinct module types (default: one per slot)"
+    )
+    parser.add_argument("--inputs", type=int, default=8, help="inputs per module")
+    parser.add_argument("--outputs", type=int, default=8, help="outputs per module")
+    parser.add_argument("--params", type=int, default=2, help="parameters per module")
+    parser.add_argument("--alarms", type=int, default=1, help="alarms per module")
+    parser.add_argument(
+        "--datatypes",
+        type=lambda s: s.split(","),
+        default=DATATYPES,
+        help="comma-separated datatypes to cycle through",
+    )
+    parser.add_argument("-o", "--output", required=True)
+    args = parser.parse_args()
+
+    if args.slots < 1:
+        parser.error("at least one slot is required")
+
+    with open(args.output, "w") as f:
+        json.dump(make_model(args), f, indent=2)
+        f.write("\n")
+
+
+if __name__ == "__main__":
+    main()
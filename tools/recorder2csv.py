@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+#********************************************************************
+#        _       _         _
+#  _ __ | |_  _ | |  __ _ | |__   ___
+# | '__|| __|(_)| | / _` || '_ \ / __|
+# | |   | |_  _ | || (_| || |_) |\__ \
+# |_|    \__|(_)|_| \__,_||_.__/ |___/
+#
+# www.rt-labs.com
+# Copyright 2024 rt-labs AB, Sweden.
+# See LICENSE file in the project root for full license information.
+#*******************************************************************/
+
+"""Decode a flight recorder dump to CSV.
+
+The dump is written by the sample application when built with
+ENABLE_FLIGHT_RECORDER, see src/app_recorder.h for the format. Each
+record becomes one row with its time in microseconds, event type and
+value. Cycle rows hold the value and status of every signal; status
+rows the device status word; param rows the slot and parameter index
+and the value bytes in hex; error rows the error code.
+
+Example:
+  recorder2csv.py /tmp/u-phy-recorder.bin -o recorder.csv
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+MAGIC = b"UPFR"
+VERSION = 2
+
+HEADER = struct.Struct("<4sHxxIIIIIIII")
+RECORD = struct.Struct("<QIIB7x")
+SIGNAL = struct.Struct("<BcHIB")
+
+RECORD_TYPES = {1: "cycle", 2: "status", 3: "param", 4: "error"}
+
+
+def read_signals(data, offset, n_signals):
+    signals = []
+    for _ in range(n_signals):
+        section, fmt, size, value_offset, name_len = SIGNAL.unpack_from(data, offset)
+        offset += SIGNAL.size
+        name = data[offset : offset + name_len].decode("utf-8", "replace")
+        offset += name_len
+        signals.append((section, fmt.decode(), size, value_offset, name))
+    return signals, offset
+
+
+def decode_value(fmt, raw):
+    if fmt != "s" and struct.calcsize("<" + fmt) == len(raw):
+        return struct.unpack("<" + fmt, raw)[0]
+    return raw.hex()
+
+
+def decode(data, out):
+    (
+        magic,
+        version,
+        record_size,
+        n_records,
+        _,
+        inputs_size,
+        inputs_status,
+        outputs_size,
+        outputs_status,
+        n_signals,
+    ) = HEADER.unpack_from(data, 0)
+    if magic != MAGIC:
+        raise ValueError("not a flight recorder dump")
+    if version != VERSION:
+        raise ValueError("unsupported version %d" % version)
+
+    signals, offset = read_signals(data, HEADER.size, n_signals)
+    base = (0, inputs_size)
+    status_base = (inputs_status, inputs_size + outputs_status)
+    index = [0, 0]
+    columns = []
+    for section, fmt, size, value_offset, name in signals:
+        columns.append(
+            (fmt, base[section] + value_offset, size, status_base[section] + index[section])
+        )
+        index[section] += 1
+
+    writer = csv.writer(out)
+    header = ["time_us", "event", "value", "data"]
+    for _, _, _, _, name in signals:
+        header += [name, name + ".status"]
+    writer.writerow(header)
+
+    for i in range(n_records):
+        start = offset + i * record_size
+        time, value, length, rtype = RECORD.unpack_from(data, start)
+        payload = data[start + RECORD.size : start + RECORD.size + length]
+        event = RECORD_TYPES.get(rtype, str(rtype))
+        row = [time, event]
+        if event == "cycle":
+            row += ["0x%08x" % value, ""]
+            for fmt, value_offset, size, status_offset in columns:
+                row.append(decode_value(fmt, payload[value_offset : value_offset + size]))
+                row.append("0x%02x" % payload[status_offset])
+        elif event == "status":
+            row += ["0x%08x" % value, ""]
+        elif event == "param":
+            row += ["%d:%d" % (value >> 16, value & 0xFFFF), payload.hex()]
+        else:
+            row += [value, payload.hex()]
+        writer.writerow(row)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+    )
+    parser.add_argument("dump", help="flight recorder dump")
+    parser.add_argument("-o", "--output", help="CSV file (default: stdout)")
+    args = parser.parse_args()
+
+    with open(args.dump, "rb") as f:
+        data = f.read()
+
+    try:
+        if args.output:
+            with open(args.output, "w", newline="") as out:
+                decode(data, out)
+        else:
+            decode(data, sys.stdout)
+    except (ValueError, struct.error) as e:
+        sys.exit("%s: %s" % (args.dump, e))
+
+
+if __name__ == "__main__":
+    main()